@@ -0,0 +1,57 @@
+/*
+ * xyc-als21c-k1 example: non-blocking measurement.
+ * starts a measurement, and only reads the sensor when the sample is ready.
+ * the loop blinks the led in the meantime; there is no delay().
+ *
+ * stm32f103 pins:
+ * PB6 xyc-als21c-k1 SCL
+ * PB7 xyc-als21c-k1 SDA
+ * PB8 xyc-als21c-k1 INT
+ */
+
+#include <Wire.h>
+#include "xyc_als21c_k1.h"
+using namespace als21c;
+
+uint32_t led_time = 0;
+bool led_on = false;
+
+void setup() {
+  // put your setup code here, to run once:
+  while (!Serial)
+    ;
+  Serial.begin(115200);
+
+  pinMode(LED_BUILTIN, OUTPUT);
+
+  Wire.begin();
+
+  if (!als21c_begin()) {
+    Serial.println("xyc_als21c not found");
+    while (1)
+      ;
+  } else
+    Serial.println("xyc_als21c found");
+
+  als21c_set_auto_lux_mode(ALS21C_AUTO_LUX_PREDICT);
+  als21c_set_wait_time_millisec(250);
+  als21c_start(false);  // continuous; als21c_start(true) for a single measurement
+}
+
+void loop() {
+  // put your main code here, to run repeatedly:
+  int32_t lux = als21c_poll(micros());  // no I2C until the sample is ready
+  if (lux == ALS21C_ERR_SATURATION) Serial.println("SATURATION");
+  else if (lux == ALS21C_ERR_OVERFLOW) Serial.println("OVERFLOW");
+  else if (lux >= 0) {
+    Serial.print("lux: ");
+    Serial.println(lux);
+  }
+
+  // other work
+  if (millis() - led_time >= 500) {
+    led_time = millis();
+    led_on = !led_on;
+    digitalWrite(LED_BUILTIN, led_on);
+  }
+}
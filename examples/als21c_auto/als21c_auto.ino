@@ -28,6 +28,7 @@ void setup() {
     Serial.println("xyc_als21c found");
 
   als21c_set_auto_lux(true);
+  // als21c_set_auto_lux_mode(ALS21C_AUTO_LUX_PREDICT);
   als21c_set_wait_time_millisec(250);
   als21c_enable(true);
 }
@@ -1,6 +1,8 @@
 /*
  * xyc-als21c-k1 interrupt example.
- * The processor is interrupted when light intensity changes 12.5% or 10 counts, whichever is bigger.
+ * The processor is interrupted when light intensity changes 12% or 10 lux, whichever is bigger.
+ * The interrupt handler only queues the time of the interrupt;
+ * als21c_irq_handle() in loop() reads the sensor and re-arms the thresholds.
  *
  * stm32f103 pins:
  * PB6 xyc-als21c-k1 SCL
@@ -14,11 +16,10 @@ using namespace als21c;
 
 #define PIN_INTERRUPT PB8
 
-volatile bool interrupted = false;
+als21c_irq_t irq;
 
 void als21c_interrupt() {
-  interrupted = true;
-  als21c_clear_interrupt();
+  als21c_irq_isr(&irq);  // no I2C in interrupt context
 }
 
 void setup() {
@@ -29,9 +30,6 @@ void setup() {
 
   Wire.begin();
 
-  pinMode(PIN_INTERRUPT, INPUT);
-  attachInterrupt(PIN_INTERRUPT, als21c_interrupt, FALLING);
-
   if (!als21c_begin()) {
     Serial.println("xyc_als21c not found");
     while (1)
@@ -44,42 +42,29 @@ void setup() {
   als21c_set_wait_time_millisec(250);
   als21c_enable(true);
 
-  als21c_set_low_threshold(1000);
-  als21c_set_high_threshold(1000);
-  als21c_set_persistence(3);
-  als21c_clear_interrupt();
-  als21c_enable_interrupt(true);
+  als21c_irq_init(&irq, &als21c_dev);
+  als21c_irq_set_hysteresis(&irq, 10, 12);
+  pinMode(PIN_INTERRUPT, INPUT);
+  attachInterrupt(PIN_INTERRUPT, als21c_interrupt, FALLING);
+  als21c_irq_enable(&irq, 3);
 }
 
 void loop() {
   // put your main code here, to run repeatedly:
+  als21c_reading_t reading;
 
-  if (interrupted) {
-    int32_t als, delta, als_low, als_high;
-
-    interrupted = false;
-    als = als21c_read_als();
+  als21c_irq_handle(&irq);
 
-    if (als == ALS21C_ERR_NOT_READY)
-      Serial.println("WAIT");
-    else if (als == ALS21C_ERR_SATURATION)
+  while (als21c_irq_read(&irq, &reading)) {
+    if (reading.lux == ALS21C_ERR_SATURATION)
       Serial.println("SATURATION");
-    else if (als == ALS21C_ERR_OVERFLOW)
+    else if (reading.lux == ALS21C_ERR_OVERFLOW)
       Serial.println("OVERFLOW");
     else {
-      Serial.print("als: ");
-      Serial.println(als);
-    }
-    if (als >= 0) {
-      delta = als / 8;
-      if (delta < 10) delta = 10;
-      als_low = als - delta;
-      if (als_low < 0) als_low = 0;
-      als21c_set_low_threshold(als_low);
-      als_high = als + delta;
-      if (als_high > 0xffff) als_high = 0xffff;
-      als21c_set_high_threshold(als_high);
+      Serial.print("lux: ");
+      Serial.print(reading.lux);
+      Serial.print(" als: ");
+      Serial.println(reading.count);
     }
   }
-  delay(1000);
 }
@@ -0,0 +1,56 @@
+/*
+ * xyc-als21c-k1 example: several sensors behind a TCA9548 I2C multiplexer.
+ * prints light intensity of every sensor every second.
+ *
+ * stm32f103 pins:
+ * PB6 tca9548 SCL
+ * PB7 tca9548 SDA
+ * tca9548 channels 0..3: xyc-als21c-k1
+ */
+
+#include <Wire.h>
+#include "xyc_als21c_k1.h"
+using namespace als21c;
+
+#define NUM_SENSORS 4
+
+als21c_bus_t bus;
+als21c_dev_t sensor[NUM_SENSORS];
+
+void setup() {
+  // put your setup code here, to run once:
+  while (!Serial)
+    ;
+  Serial.begin(115200);
+
+  Wire.begin();
+
+  als21c_bus_init(&bus, &Wire, ALS21C_MUX_ADDR);
+  for (int i = 0; i < NUM_SENSORS; i++) {
+    als21c_init(&sensor[i], &bus, i);
+    if (!als21c_begin(&sensor[i])) {
+      Serial.print("xyc_als21c not found on channel ");
+      Serial.println(i);
+      continue;
+    }
+    als21c_set_auto_lux(&sensor[i], true);
+    als21c_set_wait_time_millisec(&sensor[i], 250);
+    als21c_enable(&sensor[i], true);
+  }
+}
+
+void loop() {
+  // put your main code here, to run repeatedly:
+  for (int i = 0; i < NUM_SENSORS; i++) {
+    int32_t lux = als21c_read_lux(&sensor[i]);
+    Serial.print(i);
+    if (lux == ALS21C_ERR_NOT_READY) Serial.println(" WAIT");
+    else if (lux == ALS21C_ERR_SATURATION) Serial.println(" SATURATION");
+    else if (lux == ALS21C_ERR_OVERFLOW) Serial.println(" OVERFLOW");
+    else {
+      Serial.print(" lux: ");
+      Serial.println(lux);
+    }
+  }
+  delay(1000);
+}
@@ -0,0 +1,196 @@
+/*!
+ *
+ * 	I2C Driver for NEWOPT XYC_ALS21C ambient light sensor
+ *
+ *      linux host program. one coroutine per sensor, lux = co_await
+ *      sensor.read_lux(), all on one thread.
+ *
+ *      simulator. 256 sensors on 32 buses, each behind a multiplexer; every
+ *      sensor its own light level and clock error, auto lux on. on
+ *      als21c_sim_loop, 10 s of simulated time: readings per second, and
+ *      transactions per reading; waiting for the deadline, and waiting for
+ *      the INT line. then 64 sensors on als21c_epoll_loop, 2 s in real time:
+ *      readings per second, and processor time used.
+ *      g++ -std=c++20 -O2 -DALS21C_SIM -I src -o coro_bench extras/coro_bench.cpp src/xyc_als21c_k1*.cpp
+ *      ./coro_bench
+ *
+ *      linux i2c-dev, one sensor, optionally with INT on a gpio line:
+ *      g++ -std=c++20 -O2 -I src -o coro_bench extras/coro_bench.cpp src/xyc_als21c_k1*.cpp
+ *      ./coro_bench /dev/i2c-1 [/dev/gpiochip0 line]
+ */
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <sys/resource.h>
+#include <xyc_als21c_k1.h>
+#include <xyc_als21c_k1_coro.h>
+#include <xyc_als21c_k1_transport.h>
+
+using namespace als21c;
+
+#ifdef ALS21C_SIM
+
+#define BUSES 32
+#define CHANNELS 8
+#define N (BUSES * CHANNELS)
+
+typedef struct {
+  als21c_sim sensor[N];
+  als21c_sim_bus sim_bus[BUSES];
+  als21c_bus_t bus[BUSES];
+  als21c_dev_t dev[N];
+} sim_t;
+
+typedef struct {
+  uint32_t readings;
+  uint32_t errors;
+} stats_t;
+
+static uint64_t real_now(void *) {
+  return als21c_epoll_loop::now_us();
+}
+
+static void real_wait(void *, uint64_t t_us) {
+  struct timespec ts;
+  ts.tv_sec = t_us / 1000000;
+  ts.tv_nsec = (t_us % 1000000) * 1000;
+  clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+}
+
+static void setup(sim_t *s, int n, bool real_time) {
+  for (int b = 0; b < (n + CHANNELS - 1) / CHANNELS; b++) {
+    if (real_time)
+      s->sim_bus[b].set_clock(real_now, real_wait, NULL);
+    else
+      s->sim_bus[b].share_clock(&s->sim_bus[0]);
+    s->sim_bus[b].bus_hz = 400000;
+    als21c_bus_init(&s->bus[b], &s->sim_bus[b], ALS21C_MUX_ADDR);
+  }
+  for (int i = 0; i < n; i++) {
+    int b = i / CHANNELS, c = i % CHANNELS;
+    /* 10 to 30000 lux */
+    s->sensor[i].set_lux(10 * powf(3000, (float)((i * 37) % N) / N));
+    s->sensor[i].clock_ppm = (i * 7919) % 20000 - 10000;
+    s->sim_bus[b].attach(&s->sensor[i], c);
+    als21c_init(&s->dev[i], &s->bus[b], c);
+    als21c_begin(&s->dev[i]);
+    als21c_set_auto_lux_mode(&s->dev[i], ALS21C_AUTO_LUX_PREDICT);
+  }
+}
+
+/* one sensor: read until t_end of micros() */
+template<class Loop>
+static als21c_task<void> reader(Loop &loop, als21c_dev_t *dev, typename Loop::irq_t irq, uint32_t t_end, stats_t *st) {
+  als21c_async<Loop> sensor(loop, dev, irq);
+  while ((int32_t)(loop.micros() - t_end) < 0) {
+    int32_t lux = co_await sensor.read_lux();
+    st->readings++;
+    if (lux < 0) st->errors++;
+  }
+  sensor.stop();
+}
+
+static void simulated(bool irq) {
+  sim_t *s = new sim_t();
+  static stats_t st[N];
+  uint32_t transactions = 0, readings = 0, errors = 0;
+
+  setup(s, N, false);
+  als21c_sim_loop loop(&s->sim_bus[0]);
+  uint64_t t0 = s->sim_bus[0].now();
+  for (int b = 0; b < BUSES; b++) transactions -= s->sim_bus[b].transactions;
+  for (int i = 0; i < N; i++) {
+    st[i] = stats_t();
+    loop.spawn(reader(loop, &s->dev[i], irq ? &s->sensor[i] : als21c_sim_loop::no_irq, loop.micros() + 10000000, &st[i]));
+  }
+  loop.run();
+  double seconds = (s->sim_bus[0].now() - t0) / 1e6;
+  for (int b = 0; b < BUSES; b++) transactions += s->sim_bus[b].transactions;
+  for (int i = 0; i < N; i++) {
+    readings += st[i].readings;
+    errors += st[i].errors;
+  }
+  printf("%-9s %8u %8.2f %10.0f %12.2f %6u\n", irq ? "INT line" : "deadline", readings, seconds, readings / seconds,
+         (double)transactions / readings, errors);
+  delete s;
+}
+
+static void real_time(int n) {
+  sim_t *s = new sim_t();
+  static stats_t st[N];
+  struct rusage ru0, ru1;
+  uint32_t readings = 0;
+
+  setup(s, n, true);
+  als21c_epoll_loop loop;
+  getrusage(RUSAGE_SELF, &ru0);
+  uint64_t t0 = loop.now_us();
+  for (int i = 0; i < n; i++) {
+    st[i] = stats_t();
+    loop.spawn(reader(loop, &s->dev[i], als21c_epoll_loop::no_irq, loop.micros() + 2000000, &st[i]));
+  }
+  loop.run();
+  double seconds = (loop.now_us() - t0) / 1e6;
+  getrusage(RUSAGE_SELF, &ru1);
+  double cpu = (ru1.ru_utime.tv_sec - ru0.ru_utime.tv_sec) + (ru1.ru_utime.tv_usec - ru0.ru_utime.tv_usec) / 1e6 +
+               (ru1.ru_stime.tv_sec - ru0.ru_stime.tv_sec) + (ru1.ru_stime.tv_usec - ru0.ru_stime.tv_usec) / 1e6;
+  for (int i = 0; i < n; i++) readings += st[i].readings;
+  printf("%d sensors, epoll loop, real time: %u readings in %.2f s, %.0f per s, processor %.0f%%\n", n, readings,
+         seconds, readings / seconds, 100 * cpu / seconds);
+  delete s;
+}
+
+int main() {
+  printf("%d sensors, %d buses at 400 kHz, auto lux, simulated time\n", N, BUSES);
+  printf("%-9s %8s %8s %10s %12s %6s\n", "wait for", "readings", "seconds", "per s", "transactions", "errors");
+  simulated(false);
+  simulated(true);
+  printf("\n");
+  real_time(64);
+  return 0;
+}
+
+#else
+
+static als21c_task<void> print_readings(als21c_epoll_loop &loop, als21c_dev_t *dev, int irq_fd, int n) {
+  als21c_async<als21c_epoll_loop> sensor(loop, dev, irq_fd);
+  for (int i = 0; i < n; i++) {
+    int32_t lux = co_await sensor.read_lux();
+    printf("%u %d lux, gain %u itime %u\n", loop.micros(), lux, dev->track->gain, dev->track->itime);
+  }
+  sensor.stop();
+}
+
+int main(int argc, char **argv) {
+  als21c_linux_bus_t adapter;
+  als21c_bus_t bus;
+  als21c_dev_t dev;
+  int irq_fd = -1;
+
+  if (argc != 2 && argc != 4) {
+    fprintf(stderr, "usage: %s /dev/i2c-N [/dev/gpiochipN line]\n", argv[0]);
+    return 1;
+  }
+  if (!als21c_linux_open(&adapter, &bus, argv[1], ALS21C_MUX_ADDR)) {
+    fprintf(stderr, "%s: %s\n", argv[1], strerror(adapter.error));
+    return 1;
+  }
+  if (argc == 4 && (irq_fd = als21c_linux_gpio_open(argv[2], atoi(argv[3]))) < 0) {
+    perror(argv[2]);
+    return 1;
+  }
+  als21c_init(&dev, &bus, ALS21C_MUX_NONE);
+  if (!als21c_begin(&dev)) {
+    fprintf(stderr, "no sensor\n");
+    return 1;
+  }
+  als21c_set_auto_lux_mode(&dev, ALS21C_AUTO_LUX_PREDICT);
+
+  als21c_epoll_loop loop;
+  loop.spawn(print_readings(loop, &dev, irq_fd, 20));
+  loop.run();
+  return 0;
+}
+
+#endif
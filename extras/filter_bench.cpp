@@ -0,0 +1,87 @@
+/*!
+ *
+ * 	I2C Driver for NEWOPT XYC_ALS21C ambient light sensor
+ *
+ *      host program. filters a synthetic stream at 854 samples/s: 500 lux,
+ *      a step to 800 lux, noise and spikes. reports the error of each stage
+ *      and the time per sample.
+ *
+ *      g++ -std=c++11 -O2 -I src -o filter_bench extras/filter_bench.cpp src/xyc_als21c_k1_filter.cpp
+ *      ./filter_bench
+ */
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+#include <xyc_als21c_k1.h>
+
+using namespace als21c;
+
+static uint32_t rng = 1;
+
+/* uniform 0 .. 65535 */
+static int32_t rnd() {
+  rng = rng * 1664525 + 1013904223;
+  return rng >> 16;
+}
+
+/* light, 1 s at 500 lux, then 800 lux */
+static int32_t light(uint32_t i) {
+  return i < 854 ? 500 : 800;
+}
+
+/* light, with noise of about 10 lux rms, and one sample in 100 a spike */
+static int32_t sample(uint32_t i) {
+  int32_t noise = (rnd() + rnd() + rnd() - 3 * 32768) * 10 / 32768;
+  if (rnd() % 100 == 0) return light(i) + 2000;
+  return light(i) + noise;
+}
+
+static void report(const char *name, const std::vector<int32_t> &in, uint8_t median_n, uint8_t ema_shift, uint16_t decimate_n) {
+  als21c_filter_t filter;
+  double sq = 0, max = 0;
+  uint32_t n = 0, settle = 0;
+  int32_t out;
+  als21c_filter_init(&filter, median_n, ema_shift, decimate_n);
+  for (uint32_t i = 0; i < in.size(); i++) {
+    if (!als21c_filter_sample(&filter, in[i], &out)) continue;
+    double err = out - light(i);
+    /* error on steady light; after the step, time to within 2% */
+    if (i < 854 || i >= 854 + 200) {
+      sq += err * err;
+      if (fabs(err) > max) max = fabs(err);
+      n++;
+    }
+    if (i >= 854 && settle == 0 && fabs(err) < 16) settle = i - 854 + 1;
+  }
+  printf("%-28s %8.1f %8.0f %8.1f\n", name, sqrt(sq / n), max, settle * 1171 / 1000.0);
+}
+
+int main() {
+  const uint32_t len = 2 * 854;
+  std::vector<int32_t> in(len);
+  for (uint32_t i = 0; i < len; i++) in[i] = sample(i);
+
+  printf("%-28s %8s %8s %8s\n", "filter", "rms", "max", "step");
+  printf("%-28s %8s %8s %8s\n", "", "lux", "lux", "ms");
+  report("none", in, 1, 0, 1);
+  report("median 3", in, 3, 0, 1);
+  report("median 5", in, 5, 0, 1);
+  report("ema 1/8", in, 1, 3, 1);
+  report("ema 1/32", in, 1, 5, 1);
+  report("median 3, ema 1/8", in, 3, 3, 1);
+  report("median 3, ema 1/8, 85:1", in, 3, 3, 85);
+
+  als21c_filter_t filter;
+  const uint32_t n = 10000000;
+  volatile int32_t sink = 0;
+  int32_t out;
+  als21c_filter_init(&filter, 5, 3, 85);
+  auto t0 = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < n; i++)
+    if (als21c_filter_sample(&filter, in[i % len], &out)) sink = sink + out;
+  double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count() / n;
+  printf("median 5, ema 1/8, 85:1: %.1f ns per sample, %u bytes state\n", ns, (unsigned)sizeof(filter));
+  return 0;
+}
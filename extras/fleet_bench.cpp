@@ -0,0 +1,147 @@
+/*!
+ *
+ * 	I2C Driver for NEWOPT XYC_ALS21C ambient light sensor
+ *
+ *      host program. 32 simulated sensors on 4 buses, each behind a
+ *      multiplexer with 8 channels, driven by one program. refresh time of
+ *      the fleet, time between two readings of a sensor: one after the other,
+ *      and with als21c_fleet_poll(), single and continuous measurements.
+ *
+ *      g++ -std=c++11 -O2 -DALS21C_SIM -I src -o fleet_bench extras/fleet_bench.cpp src/xyc_als21c_k1*.cpp
+ *      ./fleet_bench
+ */
+
+#include <cstdio>
+#include <xyc_als21c_k1.h>
+#include <xyc_als21c_k1_transport.h>
+
+using namespace als21c;
+
+#define BUSES 4
+#define CHANNELS 8
+#define N (BUSES * CHANNELS)
+
+typedef struct {
+  als21c_sim sensor[N];
+  als21c_sim_bus sim_bus[BUSES];
+  als21c_bus_t bus[BUSES];
+  als21c_dev_t dev[N];
+} fleet_sim_t;
+
+static void setup(fleet_sim_t *s, uint32_t bus_hz, uint32_t itime) {
+  for (int b = 0; b < BUSES; b++) {
+    s->sim_bus[b].share_clock(&s->sim_bus[0]);
+    s->sim_bus[b].bus_hz = bus_hz;
+    als21c_bus_init(&s->bus[b], &s->sim_bus[b], ALS21C_MUX_ADDR);
+  }
+  for (int i = 0; i < N; i++) {
+    int b = i / CHANNELS, c = i % CHANNELS;
+    /* sensor clocks differ a little */
+    s->sensor[i].clock_ppm = (i * 7919) % 20000 - 10000;
+    s->sensor[i].set_lux(100 + 10 * i);
+    s->sim_bus[b].attach(&s->sensor[i], c);
+    als21c_init(&s->dev[i], &s->bus[b], c);
+    als21c_begin(&s->dev[i]);
+    als21c_set_gain_value(&s->dev[i], 16);
+    als21c_set_integration_time(&s->dev[i], itime);
+  }
+}
+
+static uint32_t mux_writes(fleet_sim_t *s) {
+  uint32_t n = 0;
+  for (int b = 0; b < BUSES; b++) n += s->sim_bus[b].mux_writes;
+  return n;
+}
+
+static void sleep_until(fleet_sim_t *s, uint32_t deadline) {
+  int32_t wait_us = deadline - uint32_t(s->sim_bus[0].now());
+  s->sim_bus[0].advance(wait_us > 0 ? wait_us : 1);
+}
+
+/* one sensor after the other: start, wait, read */
+static void sequential(uint32_t bus_hz, uint32_t itime) {
+  fleet_sim_t &s = *new fleet_sim_t();
+  setup(&s, bus_hz, itime);
+  uint64_t t0 = s.sim_bus[0].now();
+  uint32_t sw0 = mux_writes(&s), readings = 0;
+  for (int sweep = 0; sweep < 4; sweep++) {
+    for (int i = 0; i < N; i++) {
+      als21c_dev_t *dev = &s.dev[i];
+      als21c_start(dev, true);
+      while (als21c_poll(dev, als21c_micros(dev)) == ALS21C_ERR_NOT_READY) sleep_until(&s, als21c_get_deadline(dev));
+      readings++;
+    }
+  }
+  double refresh_ms = (s.sim_bus[0].now() - t0) / 1000.0 / (readings / N);
+  printf("%7u %6.1f %-12s %8.1f %8.1f %8.2f\n", bus_hz / 1000, itime * 1.171, "sequential", refresh_ms, refresh_ms,
+         (double)(mux_writes(&s) - sw0) / readings);
+  delete &s;
+}
+
+/* all at once, read in deadline order */
+static void fleet(uint32_t bus_hz, uint32_t itime, bool once) {
+  fleet_sim_t &s = *new fleet_sim_t();
+  als21c_fleet_t fleet;
+  uint32_t count[N] = {}, readings = 0, errors = 0, sw0;
+  uint64_t t_start, t0, t_end;
+
+  setup(&s, bus_hz, itime);
+  als21c_fleet_init(&fleet);
+  for (int i = 0; i < N; i++) als21c_fleet_add(&fleet, &s.dev[i]);
+  t_start = s.sim_bus[0].now();
+  als21c_fleet_start(&fleet, once);
+
+  /* first: until every sensor has a reading. then one second */
+  t0 = 0;
+  t_end = ~0ull;
+  sw0 = 0;
+  while (s.sim_bus[0].now() < t_end) {
+    als21c_dev_t *dev;
+    int32_t lux = als21c_fleet_poll(&fleet, uint32_t(s.sim_bus[0].now()), &dev);
+    if (lux == ALS21C_ERR_NOT_READY) {
+      sleep_until(&s, als21c_fleet_deadline(&fleet));
+      continue;
+    }
+    if (lux < 0) errors++;
+    if (t0 != 0) {
+      count[dev - s.dev]++;
+      readings++;
+    } else if (++count[dev - s.dev] == 1 && ++readings == N) {
+      t0 = s.sim_bus[0].now();
+      t_end = t0 + 1000000;
+      sw0 = mux_writes(&s);
+      readings = 0;
+      for (int i = 0; i < N; i++) count[i] = 0;
+    }
+  }
+  double switches = (double)(mux_writes(&s) - sw0) / readings;
+  als21c_fleet_stop(&fleet);
+
+  uint32_t min = count[0], max = count[0];
+  for (int i = 0; i < N; i++) {
+    if (count[i] < min) min = count[i];
+    if (count[i] > max) max = count[i];
+  }
+  double refresh_ms = 1000.0 * N / readings;
+  printf("%7u %6.1f %-12s %8.1f %8.1f %8.2f   readings per sensor %u..%u, errors %u\n", bus_hz / 1000, itime * 1.171,
+         once ? "fleet once" : "fleet cont.", (t0 - t_start) / 1000.0, refresh_ms, switches, min, max,
+         errors);
+  delete &s;
+}
+
+int main() {
+  static const uint32_t bus_hz[] = { 100000, 400000, 1000000 };
+  static const uint32_t itime[] = { 16, 64 };
+  printf("%d sensors, %d buses\n", N, BUSES);
+  printf("%7s %6s %-12s %8s %8s %8s\n", "bus kHz", "int ms", "", "first ms", "refresh", "switches");
+  for (uint32_t t : itime)
+    for (uint32_t hz : bus_hz) {
+      /* one burst read and one multiplexer switch per sensor */
+      double bus_ms = N * (3 + 9 * (3 + ALS21C_BURST_LEN) + 2 + 9 * 2) * 1000.0 / hz;
+      sequential(hz, t);
+      fleet(hz, t, true);
+      fleet(hz, t, false);
+      printf("%7u %6.1f %-12s %8.1f\n\n", hz / 1000, t * 1.171, "int + reads", t * 1.171 + bus_ms);
+    }
+  return 0;
+}
@@ -0,0 +1,137 @@
+/*!
+ *
+ * 	I2C Driver for NEWOPT XYC_ALS21C ambient light sensor
+ *
+ *      host program. streams samples from the simulator, lit by lamps with
+ *      known flicker, through als21c_flicker_sample(), and compares percent
+ *      flicker and flicker index with the values computed from the light.
+ *      also times als21c_flicker_sample().
+ *
+ *      g++ -std=c++11 -O2 -DALS21C_SIM -I src -o flicker_bench extras/flicker_bench.cpp src/xyc_als21c_k1*.cpp
+ *      ./flicker_bench
+ */
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <xyc_als21c_k1.h>
+#include <xyc_als21c_k1_transport.h>
+
+using namespace als21c;
+
+/* lamp: mean lux, modulation at freq_hz. duty 0: sine ripple of depth; else pwm, on for duty of the period */
+typedef struct {
+  const char *name;
+  uint16_t mains_hz;
+  double lux;
+  double freq_hz;
+  double depth;
+  double duty;
+} lamp_t;
+
+static float lamp_lux(void *ctx, uint64_t t_us) {
+  const lamp_t *lamp = (const lamp_t *)ctx;
+  double phase = fmod(t_us * 1e-6 * lamp->freq_hz, 1.0);
+  if (lamp->duty == 0) return lamp->lux * (1 + lamp->depth * sin(2 * M_PI * phase));
+  return phase < lamp->duty ? lamp->lux / lamp->duty : 0;
+}
+
+/* percent flicker and flicker index of the light, over one period, 0.01 % and 1/1000 */
+static void lamp_flicker(const lamp_t *lamp, double *percent, double *index) {
+  const int n = 100000;
+  double min = 1e30, max = 0, sum = 0, above = 0;
+  uint64_t period_us = 1e6 / lamp->freq_hz;
+  for (int i = 0; i < n; i++) {
+    double l = lamp_lux((void *)lamp, (uint64_t)i * period_us / n);
+    if (l < min) min = l;
+    if (l > max) max = l;
+    sum += l;
+  }
+  for (int i = 0; i < n; i++) {
+    double l = lamp_lux((void *)lamp, (uint64_t)i * period_us / n);
+    if (l > sum / n) above += l - sum / n;
+  }
+  *percent = 10000 * (max - min) / (max + min);
+  *index = 1000 * above / sum;
+}
+
+static const char *kind_name[] = { "none", "mains", "other" };
+
+static void run(const lamp_t *lamp) {
+  als21c_sim sensor;
+  als21c_sim_bus sim_bus(&sensor);
+  als21c_bus_t bus;
+  als21c_dev_t dev = {};
+  als21c_track_t track;
+  als21c_flicker_t flicker;
+  als21c_flicker_result_t r = {};
+  uint32_t results = 0;
+  double percent, index;
+
+  sensor.set_light(lamp_lux, (void *)lamp);
+  sim_bus.bus_hz = 400000;
+  als21c_bus_init(&bus, &sim_bus, ALS21C_MUX_NONE);
+  als21c_init(&dev, &bus, ALS21C_MUX_NONE);
+  als21c_begin(&dev);
+  als21c_set_gain_value(&dev, lamp->duty == 0 ? 256 : 64);
+  als21c_set_track(&dev, &track);
+  als21c_stream_start(&dev);
+
+  /* 200 ms to lock on the sensor clock, then 2 s */
+  uint64_t t_lock = sim_bus.now() + 200000, t_end = t_lock + 2000000;
+  bool init = false;
+  while (sim_bus.now() < t_end) {
+    int32_t lux = als21c_poll(&dev, als21c_micros(&dev));
+    if (lux != ALS21C_ERR_NOT_READY) {
+      if (sim_bus.now() < t_lock) continue;
+      if (!init) {
+        als21c_flicker_init(&flicker, als21c_get_period(&dev), lamp->mains_hz, 512);
+        init = true;
+      }
+      if (als21c_flicker_sample(&flicker, lux)) {
+        als21c_flicker_read(&flicker, &r);
+        results++;
+      }
+    } else if ((int32_t)(als21c_get_deadline(&dev) - als21c_micros(&dev)) > 0) {
+      sim_bus.advance_to(sim_bus.now() + (int32_t)(als21c_get_deadline(&dev) - als21c_micros(&dev)));
+    }
+  }
+
+  lamp_flicker(lamp, &percent, &index);
+  printf("%-22s %6d %6.2f %6.2f %6.3f %6.3f %5.1f %6s %6u %6u", lamp->name, r.mean, percent / 100, r.percent / 100.0,
+         index / 1000, r.index / 1000.0, r.mains / 10.0, kind_name[r.kind], r.amplitude[0], r.amplitude[1]);
+  printf(" %4u\n", results);
+}
+
+/* time per sample, host */
+static void timing() {
+  als21c_flicker_t flicker;
+  const uint32_t n = 10000000;
+  volatile uint32_t results = 0;
+  als21c_flicker_init(&flicker, 1171, 50, 512);
+  auto t0 = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < n; i++)
+    results = results + als21c_flicker_sample(&flicker, 500 + (int32_t)((i * 2654435761u) >> 26));
+  double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count() / n;
+  printf("als21c_flicker_sample: %.1f ns per sample, %u filters, %u bytes state\n", ns, flicker.bins,
+         (unsigned)sizeof(flicker));
+}
+
+int main() {
+  static const lamp_t lamp[] = {
+    { "steady", 50, 500, 100, 0, 0 },
+    { "led 100 Hz 10% ripple", 50, 500, 100, 0.10, 0 },
+    { "led 100 Hz 30% ripple", 50, 500, 100, 0.30, 0 },
+    { "led 120 Hz 30% ripple", 60, 500, 120, 0.30, 0 },
+    { "pwm 100 Hz 50%", 50, 500, 100, 0, 0.5 },
+    { "pwm 180 Hz 25%", 50, 500, 180, 0, 0.25 },
+    { "pwm 330 Hz 50%", 50, 500, 330, 0, 0.5 },
+  };
+  printf("%-22s %6s %6s %6s %6s %6s %5s %6s %6s %6s %4s\n", "lamp", "mean", "pct", "pct", "index", "index", "mains",
+         "kind", "ampl1", "ampl2", "res");
+  printf("%-22s %6s %6s %6s %6s %6s %5s %6s %6s %6s %4s\n", "", "lux", "light", "meas", "light", "meas", "%", "", "lux",
+         "lux", "");
+  for (const lamp_t &l : lamp) run(&l);
+  timing();
+  return 0;
+}
@@ -0,0 +1,73 @@
+/*!
+ *
+ * 	I2C Driver for NEWOPT XYC_ALS21C ambient light sensor
+ *
+ *      host program. HDR on the simulator: lux from 1 to 100000, each
+ *      configuration alone and merged; then a step from dark to bright,
+ *      to show a reading after every measurement.
+ *
+ *      g++ -std=c++11 -O2 -DALS21C_SIM -I src -o hdr_bench extras/hdr_bench.cpp src/xyc_als21c_k1*.cpp
+ *      ./hdr_bench
+ */
+
+#include <cmath>
+#include <cstdio>
+#include <xyc_als21c_k1.h>
+#include <xyc_als21c_k1_transport.h>
+
+using namespace als21c;
+
+static const char *lux_str(int32_t lux, char *buf) {
+  if (lux == ALS21C_ERR_SATURATION)
+    return "sat";
+  else if (lux == ALS21C_ERR_OVERFLOW)
+    return "ovf";
+  snprintf(buf, 16, "%d", lux);
+  return buf;
+}
+
+/* next result of als21c_hdr_poll(), sleeping until the deadline */
+static int32_t hdr_next(als21c_hdr_t *hdr, als21c_sim_bus *sim_bus) {
+  for (;;) {
+    int32_t lux = als21c_hdr_poll(hdr, als21c_micros(hdr->dev));
+    if (lux != ALS21C_ERR_NOT_READY) return lux;
+    int32_t wait_us = als21c_get_deadline(hdr->dev) - als21c_micros(hdr->dev);
+    sim_bus->advance_to(sim_bus->now() + (wait_us > 0 ? wait_us : 1));
+  }
+}
+
+int main() {
+  als21c_sim sensor;
+  als21c_sim_bus sim_bus(&sensor);
+  als21c_bus_t bus;
+  als21c_dev_t dev = {};
+  als21c_hdr_t hdr;
+  char b0[16], b1[16], b2[16];
+
+  als21c_bus_init(&bus, &sim_bus, ALS21C_MUX_NONE);
+  als21c_init(&dev, &bus, ALS21C_MUX_NONE);
+  als21c_begin(&dev);
+  als21c_hdr_init(&hdr, &dev, 512, 16, 4, 16);
+  als21c_hdr_start(&hdr);
+
+  printf("high: gain 512, 18.7 ms. low: gain 4, 18.7 ms\n");
+  printf("%8s %8s %8s %8s %8s %8s\n", "lux", "high", "low", "hdr", "error", "weights");
+  for (double lux = 1; lux <= 110000; lux *= 2) {
+    int32_t merged = 0;
+    sensor.set_lux(lux);
+    for (int i = 0; i < 4; i++) merged = hdr_next(&hdr, &sim_bus);
+    printf("%8.0f %8s %8s %8s %7.1f%% %4u/%u\n", lux, lux_str(hdr.lux[0], b0), lux_str(hdr.lux[1], b1), lux_str(merged, b2),
+           100 * (merged - lux) / lux, hdr.weight[0], hdr.weight[1]);
+  }
+
+  printf("\nstep from 5 to 50000 lux\n%8s %8s\n", "ms", "hdr");
+  sensor.set_lux(5);
+  for (int i = 0; i < 4; i++) hdr_next(&hdr, &sim_bus);
+  uint64_t t0 = sim_bus.now();
+  sensor.set_lux(50000);
+  for (int i = 0; i < 6; i++) {
+    int32_t merged = hdr_next(&hdr, &sim_bus);
+    printf("%8.2f %8s\n", (sim_bus.now() - t0) / 1000.0, lux_str(merged, b0));
+  }
+  return 0;
+}
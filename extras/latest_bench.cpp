@@ -0,0 +1,182 @@
+/*!
+ *
+ * 	I2C Driver for NEWOPT XYC_ALS21C ambient light sensor
+ *
+ *      linux host program. one sampling thread owns a simulated sensor,
+ *      in real time, and publishes the latest reading; reader threads copy
+ *      it as fast as they can. samples per second with and without readers,
+ *      reads per second, time per read, and torn copies: readings that do
+ *      not add up. then the same with a publisher at full speed.
+ *
+ *      g++ -std=c++11 -O2 -pthread -DALS21C_SIM -I src -o latest_bench extras/latest_bench.cpp src/xyc_als21c_k1*.cpp
+ *      ./latest_bench [readers]
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <pthread.h>
+#include <sys/prctl.h>
+#include <xyc_als21c_k1.h>
+#include <xyc_als21c_k1_transport.h>
+
+using namespace als21c;
+
+#define MAX_READERS 8
+#define RUN_US 1000000
+
+static struct timespec origin;
+static als21c_latest_t latest;
+static volatile bool stop;
+static bool synthetic;
+
+static uint64_t real_now(void *) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)(ts.tv_sec - origin.tv_sec) * 1000000 + (ts.tv_nsec - origin.tv_nsec) / 1000;
+}
+
+static void real_wait(void *, uint64_t t_us) {
+  struct timespec ts = origin;
+  ts.tv_sec += t_us / 1000000;
+  ts.tv_nsec += (t_us % 1000000) * 1000;
+  if (ts.tv_nsec >= 1000000000) {
+    ts.tv_sec++;
+    ts.tv_nsec -= 1000000000;
+  }
+  clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+}
+
+/* light up and down between 20 and 20000 lux: auto lux changes range */
+static float light(void *, uint64_t t_us) {
+  uint32_t ms = (t_us / 1000) % 2000;
+  return 20 + 20 * (ms < 1000 ? ms : 2000 - ms);
+}
+
+typedef struct {
+  pthread_t thread;
+  uint64_t reads;
+  uint64_t torn;
+} reader_t;
+
+/* a copy adds up: lux from count, gain and integration time, or the pattern of the synthetic publisher */
+static bool consistent(const als21c_snapshot_t *s) {
+  if (synthetic)
+    return s->lux == (int32_t)s->t_us * 3 && s->count == (uint16_t)s->t_us && s->gain == (uint16_t)(s->t_us >> 3);
+  if (s->flags & (ALS21C_FLAG_SATURATION | ALS21C_FLAG_OVERFLOW)) return s->lux < 0;
+  return s->lux == als21c_count_to_lux_config(s->count, s->gain, s->itime);
+}
+
+static void *reader_main(void *arg) {
+  reader_t *r = (reader_t *)arg;
+  als21c_snapshot_t s;
+  while (!stop) {
+    if (!als21c_latest_read(&latest, &s)) continue;
+    if (!consistent(&s)) r->torn++;
+    r->reads++;
+  }
+  return NULL;
+}
+
+/* readers threads copy while fn publishes for RUN_US; returns publishes */
+static uint32_t run(int readers, uint32_t (*fn)(void)) {
+  static reader_t reader[MAX_READERS];
+  uint64_t reads = 0, torn = 0;
+  uint32_t published;
+
+  als21c_latest_init(&latest);
+  stop = false;
+  for (int i = 0; i < readers; i++) {
+    reader[i].reads = reader[i].torn = 0;
+    pthread_create(&reader[i].thread, NULL, reader_main, &reader[i]);
+  }
+  published = fn();
+  stop = true;
+  for (int i = 0; i < readers; i++) {
+    pthread_join(reader[i].thread, NULL);
+    reads += reader[i].reads;
+    torn += reader[i].torn;
+  }
+  printf("%7d %10u %12llu %10llu\n", readers, (unsigned)(published * 1000000ull / RUN_US),
+         (unsigned long long)(reads * 1000000ull / RUN_US), (unsigned long long)torn);
+  return published;
+}
+
+/* sampling task: streams a simulated sensor, auto lux on */
+static uint32_t sample_sensor(void) {
+  static als21c_sim sensor;
+  static als21c_sim_bus sim_bus(&sensor);
+  static als21c_bus_t bus;
+  static als21c_dev_t dev;
+  uint32_t published = 0;
+
+  sim_bus.set_clock(real_now, real_wait, NULL);
+  sim_bus.bus_hz = 400000;
+  sim_bus.latency_us = 50;
+  sensor.set_light(light, NULL);
+  als21c_bus_init(&bus, &sim_bus, ALS21C_MUX_NONE);
+  als21c_init(&dev, &bus, ALS21C_MUX_NONE);
+  als21c_begin(&dev);
+  als21c_set_auto_lux_mode(&dev, ALS21C_AUTO_LUX_PREDICT);
+  als21c_start(&dev, false);
+  uint64_t t_end = real_now(NULL) + RUN_US;
+  while (real_now(NULL) < t_end) {
+    if (als21c_latest_poll(&latest, &dev, als21c_micros(&dev)) != ALS21C_ERR_NOT_READY) {
+      published++;
+      continue;
+    }
+    int32_t wait_us = als21c_get_deadline(&dev) - als21c_micros(&dev);
+    if (wait_us > 0) real_wait(NULL, real_now(NULL) + wait_us);
+  }
+  als21c_enable(&dev, false);
+  return published;
+}
+
+/* publisher at full speed, fields in a pattern */
+static uint32_t publish_fast(void) {
+  als21c_snapshot_t s = {};
+  uint32_t published = 0;
+  uint64_t t_end = real_now(NULL) + RUN_US;
+  while (real_now(NULL) < t_end) {
+    for (int i = 0; i < 1000; i++, published++) {
+      s.t_us = published;
+      s.lux = (int32_t)published * 3;
+      s.count = (uint16_t)published;
+      s.gain = (uint16_t)(published >> 3);
+      als21c_latest_publish(&latest, &s);
+    }
+  }
+  return published;
+}
+
+int main(int argc, char **argv) {
+  int max_readers = argc > 1 ? atoi(argv[1]) : 4;
+  if (max_readers > MAX_READERS) max_readers = MAX_READERS;
+  clock_gettime(CLOCK_MONOTONIC, &origin);
+  prctl(PR_SET_TIMERSLACK, 1);
+
+  printf("sensor, continuous, auto lux\n%7s %10s %12s %10s\n", "readers", "samples/s", "reads/s", "torn");
+  run(0, sample_sensor);
+  for (int n = 1; n <= max_readers; n *= 2) run(n, sample_sensor);
+
+  synthetic = true;
+  printf("\npublisher at full speed\n%7s %10s %12s %10s\n", "readers", "publish/s", "reads/s", "torn");
+  run(0, publish_fast);
+  for (int n = 1; n <= max_readers; n *= 2) run(n, publish_fast);
+
+  /* one reader on its own: cost of a read */
+  als21c_snapshot_t s;
+  int32_t sum = 0;
+  const int reads = 10000000;
+  uint64_t t0 = real_now(NULL);
+  for (int i = 0; i < reads; i++) {
+    als21c_latest_read(&latest, &s);
+    sum += s.lux;
+  }
+  uint64_t t1 = real_now(NULL);
+  for (int i = 0; i < reads; i++) sum += als21c_latest_lux(&latest);
+  uint64_t t2 = real_now(NULL);
+  printf("\nals21c_latest_read %.1f ns, als21c_latest_lux %.1f ns (%d)\n", (t1 - t0) * 1000.0 / reads,
+         (t2 - t1) * 1000.0 / reads, sum & 1);
+  return 0;
+}
@@ -0,0 +1,89 @@
+/*!
+ *
+ * 	I2C Driver for NEWOPT XYC_ALS21C ambient light sensor
+ *
+ *      host program. checks that batch conversion gives the same lux as the
+ *      scalar conversion, and measures samples per second.
+ *
+ *      g++ -std=c++11 -O2 -mavx2 -I src -o lux_batch_bench extras/lux_batch_bench.cpp src/xyc_als21c_k1*.cpp
+ *      -msse4.1 for the SSE kernel, neither for scalar.
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <xyc_als21c_k1.h>
+
+using namespace als21c;
+
+static const uint32_t gains[] = { 1, 2, 4, 8, 16, 32, 64, 128, 256, 512 };
+
+/* every count, every gain, every integration time */
+static long check() {
+  std::vector<uint16_t> count(65536);
+  std::vector<int32_t> lux(65536);
+  long errors = 0;
+  for (uint32_t c = 0; c < 65536; c++) count[c] = c;
+  for (uint32_t gain : gains) {
+    for (uint32_t t = 1; t <= 64; t *= 4) {
+      for (uint32_t conv = 1; conv <= 16; conv++) {
+        uint32_t mul;
+        uint8_t shift;
+        als21c_scale_config(gain, t * conv, &mul, &shift);
+        als21c_count_to_lux_array(count.data(), lux.data(), count.size(), gain, t * conv);
+        for (uint32_t c = 0; c < 65536; c++)
+          if (lux[c] != als21c_count_to_lux_scale(c, mul, shift)) errors++;
+      }
+    }
+  }
+  return errors;
+}
+
+static double msps(std::chrono::steady_clock::time_point t0, size_t n) {
+  return n / std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count();
+}
+
+int main() {
+  const size_t n = 1 << 22;
+  std::vector<uint16_t> count(n);
+  std::vector<als21c_record_t> record(n);
+  std::vector<int32_t> lux(n);
+  volatile int32_t sink = 0;
+  std::chrono::steady_clock::time_point t0;
+
+#if defined(__AVX2__)
+  printf("kernel: avx2\n");
+#elif defined(__SSE4_1__)
+  printf("kernel: sse4.1\n");
+#else
+  printf("kernel: scalar\n");
+#endif
+  printf("differences from scalar: %ld\n", check());
+
+  srand(1);
+  for (size_t i = 0; i < n; i++) count[i] = rand() & 0xffff;
+  /* configuration changes every 100 samples, as with auto lux */
+  for (size_t i = 0; i < n; i++) {
+    record[i].count = count[i];
+    record[i].gain = gains[(i / 100) % 10];
+    record[i].itime = 4 * ((i / 1000) % 16 + 1);
+  }
+
+  t0 = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < n; i++) lux[i] = als21c_count_to_lux_config(count[i], 16, 4);
+  printf("als21c_count_to_lux_config  %8.1f million samples/s\n", msps(t0, n));
+  sink = sink + lux[n / 2];
+
+  t0 = std::chrono::steady_clock::now();
+  als21c_count_to_lux_array(count.data(), lux.data(), n, 16, 4);
+  printf("als21c_count_to_lux_array   %8.1f million samples/s\n", msps(t0, n));
+  sink = sink + lux[n / 2];
+
+  t0 = std::chrono::steady_clock::now();
+  als21c_record_to_lux_array(record.data(), lux.data(), n);
+  printf("als21c_record_to_lux_array  %8.1f million samples/s\n", msps(t0, n));
+  sink = sink + lux[n / 2];
+
+  return 0;
+}
@@ -0,0 +1,43 @@
+/*!
+ *
+ * 	I2C Driver for NEWOPT XYC_ALS21C ambient light sensor
+ *
+ *      host program. compares size and conversion time of the lux table
+ *      representations. On AVR, time a conversion with micros() instead.
+ *
+ *      g++ -std=c++11 -O2 -I src -o lux_table_bench extras/lux_table_bench.cpp
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <xyc_als21c_k1.h>
+#include <xyc_als21c_k1_table.h>
+
+using namespace als21c;
+
+static volatile uint32_t sink;
+
+/* ns per conversion of every count, at gain 16, 1T */
+template <class Table>
+static void bench(const char *name) {
+  static const typename Table::data_t table = Table::data();
+  const uint32_t gain = 16, itime = 1, rounds = 200;
+  uint32_t sum = 0;
+  auto t0 = std::chrono::steady_clock::now();
+  for (uint32_t r = 0; r < rounds; r++)
+    for (uint32_t count = 0; count <= 0xffff; count++)
+      sum += Table::lookup(table, (256ul * count) / (gain * itime));
+  auto t1 = std::chrono::steady_clock::now();
+  sink = sum;
+  double ns = std::chrono::duration<double, std::nano>(t1 - t0).count() / (rounds * 65536.0);
+  printf("%-22s %6zu %8.2f\n", name, sizeof(table), ns);
+}
+
+int main() {
+  printf("%-22s %6s %8s\n", "table", "bytes", "ns/conv");
+  bench<als21c_lux_table<uint32_t, 8, 131>>("uint32_t, step 1");
+  bench<als21c_lux_table<uint16_t, 8, 131>>("uint16_t << 1, step 1");
+  bench<als21c_lux_table<uint16_t, 9, 131>>("uint16_t << 1, step 2");
+  bench<als21c_lux_table<uint16_t, 10, 131>>("uint16_t << 1, step 4");
+  return 0;
+}
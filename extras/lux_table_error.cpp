@@ -0,0 +1,71 @@
+/*!
+ *
+ * 	I2C Driver for NEWOPT XYC_ALS21C ambient light sensor
+ *
+ *      host program. reports size and maximum error of the integer lux
+ *      table against the float conversion, for several table resolutions.
+ *
+ *      g++ -std=c++11 -O2 -I src -o lux_table_error extras/lux_table_error.cpp
+ */
+
+#include <cmath>
+#include <cstdio>
+#include <xyc_als21c_k1.h>
+#include <xyc_als21c_k1_table.h>
+
+using namespace als21c;
+
+/* float path of als21c_count_to_lux_config() */
+static double float_lux(uint16_t count, uint32_t gain, uint32_t itime) {
+  float x = (float)count / ((float)gain * itime);
+  if (x > (float)ALS21C_CAL_MAX_X) x = ALS21C_CAL_MAX_X;
+  float x2 = x * x;
+  float lux = ((float(ALS21C_CAL_C5) * x2 + float(ALS21C_CAL_C3)) * x2 + float(ALS21C_CAL_C1)) * x;
+  return int32_t(lux + 0.5);
+}
+
+/*
+ * every count, at every gain, at integration time 1T, up to 110000 lux.
+ * interpolation: table against the polynomial at the same normalized count.
+ * total: als21c_count_to_lux_config() integer against float path; includes
+ * truncation of the normalized count to 1/256.
+ */
+template <class Table>
+static void report(const char *type) {
+  static const typename Table::data_t table = Table::data();
+  double interp_abs = 0, interp_rel = 0, total_abs = 0, total_rel = 0;
+  for (uint32_t gain = 1; gain <= 512; gain <<= 1) {
+    for (uint32_t count = 0; count <= 0xffff; count++) {
+      if (count > ALS21C_CAL_MAX_X * gain) break;
+      uint32_t q = (256ul * count) / gain;
+      double lux = Table::lookup(table, q);
+      double exact = als21c_cal_lux(q / 256.0);
+      double ref = float_lux(count, gain, 1);
+      double err = std::fabs(lux - exact);
+      if (err > interp_abs) interp_abs = err;
+      if (exact >= 100 && err / exact > interp_rel) interp_rel = err / exact;
+      err = std::fabs(lux - ref);
+      if (err > total_abs) total_abs = err;
+      if (ref >= 100 && err / ref > total_rel) total_rel = err / ref;
+    }
+  }
+  printf("%-9s %5.2f %7u %6zu %8.0f %7.3f%% %8.0f %7.3f%%\n", type, (1 << Table::step_shift) / 256.0, Table::length,
+         sizeof(table), interp_abs, 100 * interp_rel, total_abs, 100 * total_rel);
+}
+
+int main() {
+  printf("%-9s %5s %7s %6s %17s %17s\n", "", "", "", "", "interpolation", "total");
+  printf("%-9s %5s %7s %6s %8s %8s %8s %8s\n", "entry", "step", "entries", "bytes", "lux", "rel", "lux", "rel");
+  report<als21c_lux_table<uint32_t, 6, 131>>("uint32_t");
+  report<als21c_lux_table<uint32_t, 7, 131>>("uint32_t");
+  report<als21c_lux_table<uint32_t, 8, 131>>("uint32_t");
+  report<als21c_lux_table<uint32_t, 9, 131>>("uint32_t");
+  report<als21c_lux_table<uint32_t, 10, 131>>("uint32_t");
+  report<als21c_lux_table<uint32_t, 11, 131>>("uint32_t");
+  report<als21c_lux_table<uint16_t, 7, 131>>("uint16_t");
+  report<als21c_lux_table<uint16_t, 8, 131>>("uint16_t");
+  report<als21c_lux_table<uint16_t, 9, 131>>("uint16_t");
+  report<als21c_lux_table<uint16_t, 10, 131>>("uint16_t");
+  report<als21c_lux_table<uint16_t, 11, 131>>("uint16_t");
+  return 0;
+}
@@ -0,0 +1,196 @@
+/*!
+ *
+ * 	I2C Driver for NEWOPT XYC_ALS21C ambient light sensor
+ *
+ *      linux daemon. owns the sensors, one worker thread per bus, and
+ *      publishes every reading in a shared memory ring. read the ring with
+ *      shm_reader, or als21c_shm_attach() and als21c_shm_read(); any number
+ *      of readers. runs until interrupted.
+ *
+ *      linux i2c-dev. one sensor per bus, or -m: a sensor on each channel of a multiplexer:
+ *      g++ -std=c++11 -O2 -pthread -I src -o shm_daemon extras/shm_daemon.cpp src/xyc_als21c_k1*.cpp
+ *      ./shm_daemon [-f file] [-m] /dev/i2c-1 ...
+ *
+ *      simulator, in real time. buses of 8 sensors, light changing:
+ *      g++ -std=c++11 -O2 -pthread -DALS21C_SIM -I src -o shm_daemon extras/shm_daemon.cpp src/xyc_als21c_k1*.cpp
+ *      ./shm_daemon [-f file] [buses]
+ */
+
+#include <cmath>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <unistd.h>
+#include <xyc_als21c_k1.h>
+#include <xyc_als21c_k1_shm.h>
+#include <xyc_als21c_k1_transport.h>
+#include <xyc_als21c_k1_workers.h>
+
+using namespace als21c;
+
+#define MAX_SENSORS (ALS21C_WORKERS_MAX * 8)
+
+static als21c_dev_t dev[MAX_SENSORS];
+static uint8_t dev_bus[MAX_SENSORS];
+static int n_dev;
+static volatile sig_atomic_t done;
+
+static void on_signal(int) {
+  done = 1;
+}
+
+/* CLOCK_MONOTONIC, microseconds */
+static uint64_t monotonic_us() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void add_sensor(als21c_bus_t *bus, uint8_t bus_nr, int8_t mux_channel) {
+  als21c_dev_t *d = &dev[n_dev];
+  als21c_init(d, bus, mux_channel);
+  if (!als21c_begin(d)) return;
+  /* wide range: auto lux picks gain and integration time */
+  als21c_set_auto_lux_mode(d, ALS21C_AUTO_LUX_PREDICT);
+  dev_bus[n_dev++] = bus_nr;
+}
+
+#ifdef ALS21C_SIM
+
+#define CHANNELS 8
+
+static als21c_sim sensor[MAX_SENSORS];
+static als21c_sim_bus sim_bus[ALS21C_WORKERS_MAX];
+static als21c_bus_t bus[ALS21C_WORKERS_MAX];
+
+static uint64_t real_now(void *) {
+  return monotonic_us();
+}
+
+static void real_wait(void *, uint64_t t_us) {
+  struct timespec ts;
+  ts.tv_sec = t_us / 1000000;
+  ts.tv_nsec = (t_us % 1000000) * 1000;
+  clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+}
+
+/* daylight through clouds: 10 to 10000 lux, a different phase per sensor */
+static float light(void *ctx, uint64_t t_us) {
+  intptr_t i = (intptr_t)ctx;
+  return 10 * powf(1000, 0.5f + 0.5f * sinf(t_us * 1e-6f + i));
+}
+
+static bool open_buses(int argc, char **argv) {
+  int buses = argc > 0 ? atoi(argv[0]) : 1;
+  if (buses < 1 || buses > ALS21C_WORKERS_MAX) return false;
+  for (int b = 0; b < buses; b++) {
+    sim_bus[b].set_clock(real_now, real_wait, NULL);
+    sim_bus[b].bus_hz = 400000;
+    sim_bus[b].latency_us = 100;
+    als21c_bus_init(&bus[b], &sim_bus[b], ALS21C_MUX_ADDR);
+    for (int c = 0; c < CHANNELS; c++) {
+      int i = b * CHANNELS + c;
+      sensor[i].clock_ppm = (i * 7919) % 20000 - 10000;
+      sensor[i].set_light(light, (void *)(intptr_t)i);
+      sim_bus[b].attach(&sensor[i], c);
+      add_sensor(&bus[b], b, c);
+    }
+  }
+  return true;
+}
+
+#else
+
+static als21c_linux_bus_t adapter[ALS21C_WORKERS_MAX];
+static als21c_bus_t bus[ALS21C_WORKERS_MAX];
+static bool mux;
+
+static bool open_buses(int argc, char **argv) {
+  if (argc < 1 || argc > ALS21C_WORKERS_MAX) return false;
+  for (int b = 0; b < argc; b++) {
+    const char *digits = strpbrk(argv[b], "0123456789");
+    uint8_t bus_nr = digits ? atoi(digits) : b;
+    if (!als21c_linux_open(&adapter[b], &bus[b], argv[b], ALS21C_MUX_ADDR)) {
+      fprintf(stderr, "%s: %s\n", argv[b], strerror(adapter[b].error));
+      exit(1);
+    }
+    if (!mux)
+      add_sensor(&bus[b], bus_nr, ALS21C_MUX_NONE);
+    else
+      for (int c = 0; c < 8; c++) add_sensor(&bus[b], bus_nr, c);
+  }
+  return true;
+}
+
+#endif
+
+int main(int argc, char **argv) {
+  static als21c_workers_t workers;
+  static als21c_shm_t shm;
+  const char *path = ALS21C_SHM_PATH;
+  uint64_t published = 0;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "f:m")) != -1) {
+    if (opt == 'f')
+      path = optarg;
+#ifndef ALS21C_SIM
+    else if (opt == 'm')
+      mux = true;
+#endif
+    else
+      return 1;
+  }
+  if (!open_buses(argc - optind, argv + optind)) {
+    fprintf(stderr, "usage: %s [-f file] [-m] /dev/i2c-N ... (simulator: [-f file] [buses])\n", argv[0]);
+    return 1;
+  }
+  if (n_dev == 0) {
+    fprintf(stderr, "no sensors\n");
+    return 1;
+  }
+
+  if (!als21c_shm_create(&shm, path, 4096)) {
+    perror(path);
+    return 1;
+  }
+  for (int i = 0; i < n_dev; i++) als21c_shm_set_sensor(&shm, i, dev_bus[i], dev[i].mux_channel);
+
+  signal(SIGINT, on_signal);
+  signal(SIGTERM, on_signal);
+  als21c_workers_init(&workers);
+  for (int i = 0; i < n_dev; i++) als21c_workers_add(&workers, &dev[i]);
+  if (!als21c_workers_start(&workers, false)) {
+    perror("als21c_workers_start");
+    als21c_shm_close(&shm);
+    return 1;
+  }
+  printf("%d sensors, %u buses, %s\n", n_dev, workers.n, path);
+
+  /* the only writer of the ring */
+  while (!done) {
+    als21c_worker_reading_t r;
+    while (als21c_workers_read(&workers, &r)) {
+      als21c_shm_sample_t s;
+      /* reading.t_us is micros() of the worker; to 64-bit monotonic time */
+      uint64_t now = monotonic_us();
+      s.t_us = now - (uint32_t)(als21c_micros(r.dev) - r.reading.t_us);
+      s.lux = r.reading.lux;
+      s.count = r.reading.count;
+      s.gain = r.gain;
+      s.itime = r.itime;
+      s.sensor = r.dev - dev;
+      s.flags = r.flags;
+      als21c_shm_publish(&shm, &s);
+      published++;
+    }
+    als21c_workers_wait(&workers, 100);
+  }
+
+  als21c_workers_stop(&workers);
+  als21c_shm_close(&shm);
+  printf("%llu samples published\n", (unsigned long long)published);
+  return 0;
+}
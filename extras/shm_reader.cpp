@@ -0,0 +1,77 @@
+/*!
+ *
+ * 	I2C Driver for NEWOPT XYC_ALS21C ambient light sensor
+ *
+ *      linux reader of the shared memory ring of shm_daemon. prints the
+ *      samples, or with -q only a summary: samples read, samples lost, and
+ *      time per als21c_shm_read(). start as many as you like.
+ *
+ *      g++ -std=c++11 -O2 -I src -o shm_reader extras/shm_reader.cpp src/xyc_als21c_k1_shm.cpp
+ *      ./shm_reader [-f file] [-q] [seconds]
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <unistd.h>
+#include <xyc_als21c_k1_shm.h>
+
+using namespace als21c;
+
+static uint64_t monotonic_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+int main(int argc, char **argv) {
+  als21c_shm_reader_t reader;
+  als21c_shm_sample_t s;
+  const char *path = ALS21C_SHM_PATH;
+  bool quiet = false;
+  uint64_t samples = 0, read_ns = 0, t_end;
+  struct timespec tick = { 0, 10000000 };
+  int opt;
+
+  while ((opt = getopt(argc, argv, "f:q")) != -1) {
+    if (opt == 'f')
+      path = optarg;
+    else if (opt == 'q')
+      quiet = true;
+    else
+      return 1;
+  }
+  t_end = optind < argc ? monotonic_ns() + (uint64_t)(atof(argv[optind]) * 1e9) : ~0ull;
+
+  if (!als21c_shm_attach(&reader, path)) {
+    perror(path);
+    return 1;
+  }
+  if (!quiet)
+    for (uint32_t i = 0; i < reader.hdr->sensors; i++)
+      printf("sensor %u: bus %u channel %d\n", i, reader.hdr->sensor[i].bus, reader.hdr->sensor[i].mux_channel);
+
+  /* the samples since the last tick, then sleep: no system call per sample */
+  while (monotonic_ns() < t_end) {
+    uint64_t t0 = monotonic_ns(), n = 0;
+    if (quiet) {
+      while (als21c_shm_read(&reader, &s)) n++;
+    } else {
+      while (als21c_shm_read(&reader, &s)) {
+        n++;
+        printf("%llu.%06llu %3u %8d lux %5u count gain %3u itime %3u flags %02x\n",
+               (unsigned long long)(s.t_us / 1000000), (unsigned long long)(s.t_us % 1000000), s.sensor, s.lux,
+               s.count, s.gain, s.itime, s.flags);
+      }
+    }
+    if (quiet) read_ns += monotonic_ns() - t0;
+    samples += n;
+    nanosleep(&tick, NULL);
+  }
+
+  printf("%llu samples, %llu lost", (unsigned long long)samples, (unsigned long long)reader.lost);
+  if (quiet && samples) printf(", %.0f ns per sample", (double)read_ns / samples);
+  printf("\n");
+  als21c_shm_detach(&reader);
+  return 0;
+}
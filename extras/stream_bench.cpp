@@ -0,0 +1,176 @@
+/*!
+ *
+ * 	I2C Driver for NEWOPT XYC_ALS21C ambient light sensor
+ *
+ *      host program. streams samples at the highest rate, als21c_stream_start()
+ *      and als21c_poll(), and reports samples per second, samples lost and bus
+ *      utilisation. the driver counts samples lost at least and at most.
+ *
+ *      simulator, at 100 kHz, 400 kHz and 1 MHz, sensor clock -3%, 0, +3%;
+ *      then again with the application stalling 5 ms every 97 samples, for
+ *      samples really lost:
+ *      g++ -std=c++11 -O2 -DALS21C_SIM -I src -o stream_bench extras/stream_bench.cpp src/xyc_als21c_k1*.cpp
+ *      ./stream_bench
+ *
+ *      linux i2c-dev. the bus clock is set by the kernel, e.g. in the device tree;
+ *      pass it for the utilisation estimate:
+ *      g++ -std=c++11 -O2 -I src -o stream_bench extras/stream_bench.cpp src/xyc_als21c_k1*.cpp
+ *      ./stream_bench /dev/i2c-1 400000 10
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <xyc_als21c_k1.h>
+#include <xyc_als21c_k1_transport.h>
+
+using namespace als21c;
+
+/* bits of a burst read of data status to ALS data: start, 3 + len bytes of 9 clocks, repeated start, stop */
+static const uint32_t burst_bits = 3 + 9 * (3 + ALS21C_BURST_LEN);
+
+typedef struct {
+  uint32_t samples;
+  uint32_t reads;
+  uint32_t dropped;   /* counted by the driver, at least */
+  uint32_t dropped_max; /* at most */
+  double seconds;
+  double busy_us;     /* bus time; estimated on linux */
+  uint32_t conversions; /* simulator only. +-1 at the ends of the window */
+} stream_result_t;
+
+static void print_result(const char *name, uint32_t hz, int32_t ppm, const stream_result_t &r, bool sim) {
+  printf("%-6s %7u %+4d%% %9.0f %8.0f %8u %8u", name, hz, ppm / 10000, r.samples / r.seconds, r.reads / r.seconds,
+         r.dropped, r.dropped_max);
+  if (sim)
+    printf(" %8d", (int32_t)(r.conversions - r.samples));
+  else
+    printf(" %8s", "-");
+  printf(" %6.1f%%\n", 100 * r.busy_us / (r.seconds * 1e6));
+}
+
+#ifdef ALS21C_SIM
+
+/* stream for seconds of simulated time, after 100 ms to settle. stall_us: application busy every 97 samples */
+static stream_result_t stream_sim(uint32_t hz, int32_t ppm, double seconds, uint32_t stall_us) {
+  als21c_sim sensor;
+  als21c_sim_bus sim_bus(&sensor);
+  als21c_bus_t bus;
+  als21c_dev_t dev = {};
+  als21c_track_t track;
+  stream_result_t r = {};
+  uint64_t t_start = 0, t_end;
+  uint32_t conv0 = 0, trans0 = 0;
+  uint64_t busy0 = 0;
+  uint32_t n = 0;
+  bool started = false;
+
+  sensor.clock_ppm = ppm;
+  sensor.set_lux(300);
+  sim_bus.bus_hz = hz;
+  als21c_bus_init(&bus, &sim_bus, ALS21C_MUX_NONE);
+  als21c_init(&dev, &bus, ALS21C_MUX_NONE);
+  als21c_begin(&dev);
+  als21c_set_gain_value(&dev, 16);
+  als21c_set_track(&dev, &track);
+  als21c_stream_start(&dev);
+  t_end = sim_bus.now() + 100000 + (uint64_t)(seconds * 1e6);
+
+  while (sim_bus.now() < t_end) {
+    if (!started && sim_bus.now() >= t_end - (uint64_t)(seconds * 1e6)) {
+      /* measurement window starts */
+      started = true;
+      t_start = sim_bus.now();
+      conv0 = sensor.conversions;
+      trans0 = sim_bus.transactions;
+      busy0 = sim_bus.busy_us;
+      track.dropped = 0;
+      track.dropped_max = 0;
+    }
+    int32_t lux = als21c_poll(&dev, als21c_micros(&dev));
+    if (lux != ALS21C_ERR_NOT_READY) {
+      if (started) r.samples++;
+      if (stall_us != 0 && ++n % 97 == 0) sim_bus.advance(stall_us);
+    } else if ((int32_t)(als21c_get_deadline(&dev) - als21c_micros(&dev)) > 0) {
+      /* sleep until the deadline */
+      sim_bus.advance_to(sim_bus.now() + (int32_t)(als21c_get_deadline(&dev) - als21c_micros(&dev)));
+    }
+  }
+  r.seconds = (sim_bus.now() - t_start) / 1e6;
+  r.reads = sim_bus.transactions - trans0;
+  r.busy_us = sim_bus.busy_us - busy0;
+  r.conversions = sensor.conversions - conv0;
+  r.dropped = track.dropped;
+  r.dropped_max = track.dropped_max;
+  return r;
+}
+
+int main() {
+  const uint32_t bus_hz[] = { 100000, 400000, 1000000 };
+  const int32_t clock_ppm[] = { -30000, 0, 30000 };
+  printf("%-6s %7s %5s %9s %8s %8s %8s %8s %7s\n", "", "bus", "clock", "samples/s", "reads/s", "lost", "lost", "lost", "bus");
+  printf("%-6s %7s %5s %9s %8s %8s %8s %8s %7s\n", "", "Hz", "", "", "", "at least", "at most", "actual", "busy");
+  for (uint32_t hz : bus_hz)
+    for (int32_t ppm : clock_ppm)
+      print_result("sim", hz, ppm, stream_sim(hz, ppm, 10, 0), true);
+  for (uint32_t hz : bus_hz)
+    for (int32_t ppm : clock_ppm)
+      print_result("stall", hz, ppm, stream_sim(hz, ppm, 10, 5000), true);
+  return 0;
+}
+
+#elif defined(__linux__)
+
+#include <ctime>
+
+int main(int argc, char **argv) {
+  const char *path = argc > 1 ? argv[1] : "/dev/i2c-1";
+  uint32_t hz = argc > 2 ? atoi(argv[2]) : 400000;
+  double seconds = argc > 3 ? atof(argv[3]) : 10;
+  als21c_linux_bus_t adapter;
+  als21c_bus_t bus;
+  als21c_dev_t dev = {};
+  als21c_track_t track;
+  stream_result_t r = {};
+  uint32_t t_start, trans0;
+
+  if (!als21c_linux_open(&adapter, &bus, path, ALS21C_MUX_NONE)) {
+    fprintf(stderr, "%s: cannot open\n", path);
+    return 1;
+  }
+  als21c_init(&dev, &bus, ALS21C_MUX_NONE);
+  if (!als21c_begin(&dev)) {
+    fprintf(stderr, "xyc_als21c not found\n");
+    return 1;
+  }
+  als21c_set_gain_value(&dev, 16);
+  als21c_set_track(&dev, &track);
+  als21c_stream_start(&dev);
+  trans0 = dev.transactions;
+  t_start = als21c_micros(&dev);
+
+  while (als21c_micros(&dev) - t_start < seconds * 1e6) {
+    int32_t lux = als21c_poll(&dev, als21c_micros(&dev));
+    if (lux != ALS21C_ERR_NOT_READY) {
+      r.samples++;
+    } else {
+      int32_t wait_us = als21c_get_deadline(&dev) - als21c_micros(&dev);
+      if (wait_us > 0) {
+        struct timespec ts = { 0, wait_us * 1000L };
+        nanosleep(&ts, NULL);
+      }
+    }
+  }
+  r.seconds = (als21c_micros(&dev) - t_start) / 1e6;
+  r.reads = dev.transactions - trans0;
+  r.busy_us = r.reads * (burst_bits * 1e6 / hz);
+  r.dropped = track.dropped;
+  r.dropped_max = track.dropped_max;
+  als21c_linux_close(&adapter);
+
+  printf("%-6s %7s %5s %9s %8s %8s %8s %8s %7s\n", "", "bus", "clock", "samples/s", "reads/s", "lost", "lost", "lost", "bus");
+  printf("%-6s %7s %5s %9s %8s %8s %8s %8s %7s\n", "", "Hz", "", "", "", "at least", "at most", "actual", "busy");
+  print_result("linux", hz, 0, r, false);
+  return 0;
+}
+
+#endif
@@ -0,0 +1,146 @@
+/*!
+ *
+ * 	I2C Driver for NEWOPT XYC_ALS21C ambient light sensor
+ *
+ *      linux host program. 1 to 8 simulated buses with 8 sensors each,
+ *      streaming. the simulator runs in real time; every transaction sleeps
+ *      for its time on the bus plus an injected latency, as an ioctl would.
+ *      readings per second with one thread for all buses, and with one
+ *      worker thread per bus.
+ *
+ *      g++ -std=c++11 -O2 -pthread -DALS21C_SIM -I src -o workers_bench extras/workers_bench.cpp src/xyc_als21c_k1*.cpp
+ *      ./workers_bench [latency_us]
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <sys/prctl.h>
+#include <xyc_als21c_k1.h>
+#include <xyc_als21c_k1_transport.h>
+#include <xyc_als21c_k1_workers.h>
+
+using namespace als21c;
+
+#define MAX_BUSES 8
+#define CHANNELS 8
+#define RUN_US 1000000
+
+static struct timespec origin;
+
+/* real time, microseconds since start */
+static uint64_t real_now(void *) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)(ts.tv_sec - origin.tv_sec) * 1000000 + (ts.tv_nsec - origin.tv_nsec) / 1000;
+}
+
+static void real_wait(void *, uint64_t t_us) {
+  struct timespec ts = origin;
+  ts.tv_sec += t_us / 1000000;
+  ts.tv_nsec += (t_us % 1000000) * 1000;
+  if (ts.tv_nsec >= 1000000000) {
+    ts.tv_sec++;
+    ts.tv_nsec -= 1000000000;
+  }
+  clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+}
+
+typedef struct {
+  als21c_sim sensor[MAX_BUSES * CHANNELS];
+  als21c_sim_bus sim_bus[MAX_BUSES];
+  als21c_bus_t bus[MAX_BUSES];
+  als21c_dev_t dev[MAX_BUSES * CHANNELS];
+} sim_t;
+
+static void setup(sim_t *s, int buses, uint32_t latency_us) {
+  for (int b = 0; b < buses; b++) {
+    s->sim_bus[b].set_clock(real_now, real_wait, NULL);
+    s->sim_bus[b].bus_hz = 400000;
+    s->sim_bus[b].latency_us = latency_us;
+    als21c_bus_init(&s->bus[b], &s->sim_bus[b], ALS21C_MUX_ADDR);
+  }
+  for (int i = 0; i < buses * CHANNELS; i++) {
+    int b = i / CHANNELS, c = i % CHANNELS;
+    s->sensor[i].clock_ppm = (i * 7919) % 20000 - 10000;
+    s->sensor[i].set_lux(100 + 10 * i);
+    s->sim_bus[b].attach(&s->sensor[i], c);
+    als21c_init(&s->dev[i], &s->bus[b], c);
+    als21c_begin(&s->dev[i]);
+    als21c_set_gain_value(&s->dev[i], 16);
+    als21c_set_integration_time(&s->dev[i], 4);
+  }
+}
+
+/* one thread drives all buses */
+static void one_thread(int buses, uint32_t latency_us) {
+  sim_t *s = new sim_t();
+  als21c_fleet_t fleet;
+  uint32_t readings = 0;
+
+  setup(s, buses, latency_us);
+  als21c_fleet_init(&fleet);
+  for (int i = 0; i < buses * CHANNELS; i++) als21c_fleet_add(&fleet, &s->dev[i]);
+  als21c_fleet_start(&fleet, false);
+  uint64_t t0 = real_now(NULL);
+  while (real_now(NULL) < t0 + RUN_US) {
+    als21c_dev_t *dev;
+    if (als21c_fleet_poll(&fleet, uint32_t(real_now(NULL)), &dev) != ALS21C_ERR_NOT_READY) {
+      readings++;
+      continue;
+    }
+    int32_t wait_us = als21c_fleet_deadline(&fleet) - uint32_t(real_now(NULL));
+    if (wait_us > 0) real_wait(NULL, real_now(NULL) + wait_us);
+  }
+  als21c_fleet_stop(&fleet);
+  printf("%5d %-11s %8u\n", buses, "one thread", (unsigned)(readings * 1000000ull / RUN_US));
+  delete s;
+}
+
+/* one worker per bus, one consumer */
+static void workers(int buses, uint32_t latency_us) {
+  sim_t *s = new sim_t();
+  static als21c_workers_t workers;
+  als21c_worker_reading_t r;
+  uint32_t readings = 0, overruns = 0;
+  uint64_t delay_sum = 0;
+  uint32_t delay_max = 0;
+
+  setup(s, buses, latency_us);
+  als21c_workers_init(&workers);
+  for (int i = 0; i < buses * CHANNELS; i++) als21c_workers_add(&workers, &s->dev[i]);
+  if (!als21c_workers_start(&workers, false)) {
+    perror("als21c_workers_start");
+    exit(1);
+  }
+  uint64_t t0 = real_now(NULL);
+  while (real_now(NULL) < t0 + RUN_US) {
+    while (als21c_workers_read(&workers, &r)) {
+      /* time from read to consumer */
+      uint32_t delay = uint32_t(real_now(NULL)) - r.reading.t_us;
+      delay_sum += delay;
+      if (delay > delay_max) delay_max = delay;
+      readings++;
+    }
+    als21c_workers_wait(&workers, 10);
+  }
+  als21c_workers_stop(&workers);
+  for (int b = 0; b < buses; b++) overruns += workers.worker[b].overruns;
+  printf("%5d %-11s %8u %8.0f %8u %8u\n", buses, "workers", (unsigned)(readings * 1000000ull / RUN_US),
+         readings ? (double)delay_sum / readings : 0.0, delay_max, overruns);
+  delete s;
+}
+
+int main(int argc, char **argv) {
+  uint32_t latency_us = argc > 1 ? atoi(argv[1]) : 100;
+  clock_gettime(CLOCK_MONOTONIC, &origin);
+  /* wake up on time; default timer slack is 50 us */
+  prctl(PR_SET_TIMERSLACK, 1);
+  printf("400 kHz, %u us latency per transaction, %d sensors per bus, integration 4.7 ms\n", latency_us, CHANNELS);
+  printf("%5s %-11s %8s %8s %8s %8s\n", "buses", "", "per s", "delay us", "max us", "lost");
+  for (int buses = 1; buses <= MAX_BUSES; buses *= 2) {
+    one_thread(buses, latency_us);
+    workers(buses, latency_us);
+  }
+  return 0;
+}
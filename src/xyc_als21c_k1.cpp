@@ -7,194 +7,178 @@
  *
  */
 
-#include <xyc_als21c_k1.h>
-
-#ifdef __cplusplus
 #include <cstring>
+#include <xyc_als21c_k1.h>
+#include <xyc_als21c_k1_driver.h>
+#include <xyc_als21c_k1_table.h>
+#include <xyc_als21c_k1_transport.h>
 
 #ifdef ARDUINO
 #include <Arduino.h>
 #endif
 
 namespace als21c {
-#else
-#include <string.h>
-#endif
 
-als21c_data_s als21c_data;
+/* default sensor: default bus, no multiplexer */
+static als21c_dev_t als21c_dev_default() {
+  als21c_dev_t dev;
+  als21c_init(&dev, NULL, ALS21C_MUX_NONE);
+  return dev;
+}
+
+als21c_dev_t als21c_dev = als21c_dev_default();
+als21c_data_s &als21c_data = als21c_dev.data;
 
 #define ALS21C_USE_INT
 
+/* inverse lookup table, for thresholds and ranges. in flash */
+static const als21c_count_table_t::data_t count_table ALS21C_PROGMEM = als21c_count_table_t::data();
+
+/*!
+ * @brief  scale factor of a configuration, as multiply and shift
+ * @param  gain
+ * @param  itime
+ *         integration time, in units of 1.17 ms
+ * @param  mul
+ * @param  shift
+ *         256 * count / (gain * itime) is count * mul >> shift, to within 1
+ * gain * itime is a power of two times als_conv + 1. The power of two goes into
+ * the shift, the rest into a 16-bit fixed point reciprocal. Exact if als_conv + 1
+ * is a power of two.
+ */
+void als21c_scale_config(uint32_t gain, uint32_t itime, uint32_t *mul, uint8_t *shift) {
+  uint32_t d = gain * itime;
+  uint8_t r = 0;
+  *shift = 8;
+  if (d == 0) d = 1;
+  while ((d & 1) == 0) {
+    d >>= 1;
+    ++*shift;
+  }
+  while ((d >> r) > 1) r++;
+  *shift += r;
+  /* 2^(16 + r) / d, rounded up. between 2^15 and 2^16 */
+  *mul = d == 1 ? 1ul << 16 : ((1ul << (16 + r)) + d - 1) / d;
+}
+
 #ifdef ALS21C_USE_INT
 
-/*
- * lookup table for lux values.
- * lux = 478.233 * x^1 + 0.0416391 * x^3 + -1.18758e-06 * x^5
- * where x = count / (gain * itime * (als_conv + 1))
- *
- * The relationship between lux and ALS_DATA register value has been
- * obtained by curve-fitting VEML7700 and XYC-ALS21C-K1 measurements.
- * Note that this calibration is based on a specific setup.
- * Results may vary depending on temperature, sensor, and light source.
- * If you have access to more accurate calibration data,
- * please share your findings to improve this driver.
- */
-
-static const uint32_t lux_table[] = {
-  0, 478, 957, 1436, 1916, 2396, 2878, 3362,
-  3847, 4334, 4824, 5316, 5810, 6308, 6809, 7313,
-  7821, 8333, 8849, 9369, 9894, 10424, 10958, 11498,
-  12044, 12595, 13152, 13715, 14284, 14860, 15442, 16032,
-  16628, 17232, 17843, 18461, 19087, 19721, 20364, 21014,
-  21673, 22340, 23016, 23700, 24393, 25096, 25807, 26528,
-  27258, 27997, 28745, 29504, 30271, 31049, 31836, 32633,
-  33440, 34256, 35082, 35919, 36765, 37620, 38486, 39362,
-  40247, 41142, 42047, 42962, 43886, 44819, 45763, 46715,
-  47677, 48647, 49627, 50616, 51613, 52619, 53633, 54656,
-  55686, 56725, 57771, 58824, 59885, 60952, 62026, 63107,
-  64193, 65285, 66383, 67486, 68594, 69707, 70823, 71943,
-  73067, 74193, 75322, 76454, 77587, 78721, 79856, 80991,
-  82126, 83260, 84393, 85524, 86653, 87779, 88901, 90019,
-  91133, 92241, 93343, 94438, 95526, 96606, 97677, 98738,
-  99790, 100830, 101858, 102873, 103876, 104863, 105836, 106793,
-  107732, 108654, 109557, 110441
-};
+/* lookup table for lux values, in flash. See xyc_als21c_k1_table.h */
+static const als21c_lux_table_t::data_t lux_table ALS21C_PROGMEM = als21c_lux_table_t::data();
 
-/* convert adc count to lux using integer */
-int32_t als21c_count_to_lux(uint16_t count) {
-  int32_t gain, integration_time;
-  int32_t lux;
+/* convert adc count to lux, with scale factor from als21c_scale_config(). multiply, shift and table lookup */
+int32_t als21c_count_to_lux_scale(uint16_t count, uint32_t mul, uint8_t shift) {
+  uint32_t q = (count * mul) >> shift; /* normalized counts, multiplied by 256 */
+  return als21c_lux_table_t::lookup(lux_table, q);
+}
 
-  gain = als21c_get_gain_value();
-  integration_time = als21c_get_integration_time();
+/* scale factor of current gain and integration time. recomputed only when these change */
+static void als21c_scale(als21c_dev_t *dev) {
+  uint16_t key = 0x4000 | uint16_t(dev->data.pd_sel << 7 | dev->data.pga_als) << 8 | dev->data.als_conv << 4 | dev->data.int_time;
+  if (dev->scale_key == key) return;
+  als21c_scale_config(als21c_get_gain_value(dev), als21c_get_integration_time(dev), &dev->scale_mul, &dev->scale_shift);
+  dev->scale_key = key;
+}
 
+/* convert adc count to lux using integer */
+int32_t als21c_count_to_lux_config(uint16_t count, uint32_t gain, uint32_t itime) {
+  uint32_t mul;
+  uint8_t shift;
   /* linear interpolation in lookup table. integer math, suitable for small microcontroller */
-  const uint32_t last_index = sizeof(lux_table) / sizeof(lux_table[0]) - 1;
-  int32_t q = (256 * count) / (gain * integration_time); /* normalized counts, multiplied by 256 */
-  int32_t x1 = q >> 8;
-  int32_t delta_x = q & 0xff;
-
-  if (x1 > last_index - 1) {
-    x1 = last_index - 1;
-    delta_x = 0;
-  }
-
-  /* lookup in table */
-  int32_t y1 = lux_table[x1];
-  int32_t y2 = lux_table[x1 + 1];
-  /* interpolate */
-  int32_t delta_y = ((y2 - y1) * delta_x) / 256;
-  lux = y1 + delta_y;
+  als21c_scale_config(gain, itime, &mul, &shift);
+  return als21c_count_to_lux_scale(count, mul, shift);
+}
 
-  return lux;
+/* convert adc count to lux, with current gain and integration time */
+int32_t als21c_count_to_lux(als21c_dev_t *dev, uint16_t count) {
+  als21c_scale(dev);
+  return als21c_count_to_lux_scale(count, dev->scale_mul, dev->scale_shift);
 }
 
 #else
 
-/* convert adc count to lux using float */
-int32_t als21c_count_to_lux(uint16_t count) {
-  /* datasheet: als21c measures up to 110000 lux, about x = 130.498 */
-  const float max_x = 130.498;
-  float gain, integration_time, x, x2, lux_f;
+/* convert normalized count to lux using float */
+static int32_t als21c_x_to_lux(float x) {
+  const float max_x = ALS21C_CAL_MAX_X;
+  float x2, lux_f;
   int32_t lux_i;
-  gain = als21c_get_gain_value();
-  integration_time = als21c_get_integration_time();
-  /* normalized count */
-  x = (float)count / (gain * integration_time);
   if (x > max_x) x = max_x;
-  /* lux = 478.233 * x^1 + 0.0416391 * x^3 + -1.18758e-06 * x^5 */
+  /* lux = c1 * x^1 + c3 * x^3 + c5 * x^5 */
   x2 = x * x;
-  lux_f = ((-1.18758e-06 * x2 + 0.0416391) * x2 + 478.233) * x;
+  lux_f = ((float(ALS21C_CAL_C5) * x2 + float(ALS21C_CAL_C3)) * x2 + float(ALS21C_CAL_C1)) * x;
   lux_i = lux_f + 0.5;
   return lux_i;
 }
 
-#endif
+/* convert adc count to lux using float */
+int32_t als21c_count_to_lux_config(uint16_t count, uint32_t gain, uint32_t itime) {
+  /* normalized count */
+  return als21c_x_to_lux((float)count / ((float)gain * itime));
+}
 
-/*!
- * @brief  initializes ambient light sensor
- */
-bool als21c_begin() {
-  if (als21c_get_product_id() != ALS21C_PRODUCT_ID)
-    return false;
-  /* reset */
-  als21c_reset();
-  return true;
+/* convert adc count to lux, with scale factor from als21c_scale_config() */
+int32_t als21c_count_to_lux_scale(uint16_t count, uint32_t mul, uint8_t shift) {
+  return als21c_x_to_lux((float)count * mul / ((float)(1ul << shift) * 256));
 }
 
-/*!
- * @brief  stop ambient light sensor measurement and interrupts
- */
-void als21c_end() {
-  als21c_i2c_write8(ALS21C_REG_SYSM_CTRL, 0x0); /* disable als */
-  als21c_i2c_write8(ALS21C_REG_INT_CTRL, 0x0);  /* disable interrupts */
+/* convert adc count to lux, with current gain and integration time */
+int32_t als21c_count_to_lux(als21c_dev_t *dev, uint16_t count) {
+  return als21c_count_to_lux_config(count, als21c_get_gain_value(dev), als21c_get_integration_time(dev));
 }
 
-/*!
- * @brief  reset ALS sensor
- */
-void als21c_reset() {
-  /* clear */
-  memset(&als21c_data, 0, sizeof(als21c_data));
-  /* reset */
-  als21c_data.swrst = 1;
-  als21c_set_reg_sysm_ctrl();
-  als21c_data.swrst = 0;
-  /* default values after reset */
-  als21c_data.en_aint = 0x1;
-  als21c_data.pga_als = 0x1;
-  als21c_data.int_time = 0x3;
-  als21c_data.prs_als = 0x1;
+#endif
+
+/* convert lux to adc count. inverse of als21c_count_to_lux_config(). at most 0xffff. */
+uint32_t als21c_lux_to_count_config(int32_t lux, uint32_t gain, uint32_t itime) {
+  uint64_t q, count;
+
+  if (lux <= 0) return 0;
+  /* linear interpolation in lookup table, no search or division */
+  q = als21c_count_table_t::lookup(count_table, lux); /* normalized count, multiplied by 256 << ALS21C_COUNT_TABLE_SHIFT */
+  count = (q * gain * itime + (256ul << ALS21C_COUNT_TABLE_SHIFT) - 1) >> (8 + ALS21C_COUNT_TABLE_SHIFT);
+  if (count > 0xffff) count = 0xffff;
+  return count;
 }
 
-/*!
- * @brief  switch ambient light sensor on/off
- * @param  onoff
- */
-void als21c_enable(bool onoff) {
-  als21c_data.en_als = onoff ? 0x1 : 0x0;
-  als21c_set_reg_sysm_ctrl();
+/* convert lux to adc count, with current gain and integration time */
+uint32_t als21c_lux_to_count(als21c_dev_t *dev, int32_t lux) {
+  return als21c_lux_to_count_config(lux, als21c_get_gain_value(dev), als21c_get_integration_time(dev));
 }
 
 /*!
- * @brief  switch ambient light sensor on for a single measurement
+ * @brief  hold back register writes until als21c_commit(). als21c_reset() drops them.
  */
-void als21c_enable_once(bool onoff) {
-  als21c_data.en_once = onoff ? 0x1 : 0x0;
-  als21c_set_reg_sysm_ctrl();
+void als21c_defer_writes(als21c_dev_t *dev) {
+  dev->shadow_defer = true;
 }
 
 /*!
- * @brief  set the ambient light sensor gain
- * @param  pdsel new value for pd_sel
- * @param  pdals new value for pd_als
+ * @brief  initializes I2C bus
+ * @param  bus
+ * @param  handle
+ *         os-dependent bus handle, e.g. TwoWire *. NULL for default bus.
+ * @param  mux_addr
+ *         I2C address of TCA9548-style multiplexer, if any
  */
-void als21c_set_gain(uint8_t pdsel, als21c_gain_t pdals) {
-  /* pd_sel == 1 for gain*2 */
-  als21c_data.pd_sel = pdsel & 0x1;
-  /* pd_als */
-  als21c_data.pga_als = pdals;
-  /* write gain */
-  als21c_set_reg_als_gain();
+void als21c_bus_init(als21c_bus_t *bus, void *handle, uint8_t mux_addr) {
+  bus->handle = handle;
+  bus->mux_addr = mux_addr;
+  bus->mux_channel = ALS21C_MUX_NONE;
 }
 
 /*!
- * @brief  set the ambient light sensor gain
- * @param  gain
- *         actual gain is power of two between 1 and 512
+ * @brief  initializes sensor context. does not access the sensor.
+ * @param  dev
+ * @param  bus
+ *         bus the sensor is on. NULL for default bus.
+ * @param  mux_channel
+ *         multiplexer channel, ALS21C_MUX_NONE if not behind a multiplexer
  */
-void als21c_set_gain_value(uint32_t gain) {
-  if (gain <= 1) als21c_set_gain(0, ALS21C_GAIN_1X);
-  else if (gain <= 2) als21c_set_gain(1, ALS21C_GAIN_1X);
-  else if (gain <= 4) als21c_set_gain(0, ALS21C_GAIN_4X);
-  else if (gain <= 8) als21c_set_gain(1, ALS21C_GAIN_4X);
-  else if (gain <= 16) als21c_set_gain(0, ALS21C_GAIN_16X);
-  else if (gain <= 32) als21c_set_gain(1, ALS21C_GAIN_16X);
-  else if (gain <= 64) als21c_set_gain(0, ALS21C_GAIN_64X);
-  else if (gain <= 128) als21c_set_gain(1, ALS21C_GAIN_64X);
-  else if (gain <= 256) als21c_set_gain(0, ALS21C_GAIN_256X);
-  else als21c_set_gain(1, ALS21C_GAIN_256X);
-  return;
+void als21c_init(als21c_dev_t *dev, als21c_bus_t *bus, int8_t mux_channel) {
+  memset(dev, 0, sizeof(*dev));
+  dev->bus = bus;
+  dev->addr = ALS21C_I2C_ADDR;
+  dev->mux_channel = mux_channel;
 }
 
 /*!
@@ -202,9 +186,9 @@ void als21c_set_gain_value(uint32_t gain) {
  * @return gain
  *         gain is power of two between 1 and 512
  */
-uint32_t als21c_get_gain_value() {
+uint32_t als21c_get_gain_value(als21c_dev_t *dev) {
   uint32_t gain_value;
-  switch (als21c_data.pga_als) {
+  switch (dev->data.pga_als) {
     case ALS21C_GAIN_1X: gain_value = 1; break;
     case ALS21C_GAIN_4X: gain_value = 4; break;
     case ALS21C_GAIN_16X: gain_value = 16; break;
@@ -212,72 +196,36 @@ uint32_t als21c_get_gain_value() {
     case ALS21C_GAIN_256X: gain_value = 256; break;
     default: gain_value = 1; break; /* ought never to happen */
   }
-  if (als21c_data.pd_sel) gain_value *= 2;
+  if (dev->data.pd_sel) gain_value *= 2;
   return gain_value;
 }
 
-/*!
- * @brief  set the integration time for the ADC
- * @param  itime
- * @param  icount
- */
-void als21c_set_integration(als21c_int_time_t itime, uint8_t icount) {
-  als21c_data.int_time = itime;
-  als21c_data.als_conv = icount;
-  als21c_set_reg_als_time();
-}
-
-/*!
- * @brief  set the integration time for the ADC in units of 1.17ms
- * @param  count
- *         integration time in units of 1.17 milliseconds
- */
-void als21c_set_integration_time(uint32_t count) {
-  if (count == 0) als21c_set_integration(ALS21C_INT_TIME_1T, 0);
-  else if (count <= 16) als21c_set_integration(ALS21C_INT_TIME_1T, count - 1);
-  else if (count <= 4 * 16) als21c_set_integration(ALS21C_INT_TIME_4T, count / 4 - 1);
-  else if (count <= 16 * 16) als21c_set_integration(ALS21C_INT_TIME_16T, count / 16 - 1);
-  else if (count <= 64 * 16) als21c_set_integration(ALS21C_INT_TIME_64T, count / 64 - 1);
-  else als21c_set_integration(ALS21C_INT_TIME_64T, 15); /* maximum value */
-}
-
 /*!
  * @brief  get the integration time for the ADC in units of 1.17ms
  * @param  none
  * @return integration time in units of 1.17 milliseconds
  */
-uint32_t als21c_get_integration_time(void) {
+uint32_t als21c_get_integration_time(als21c_dev_t *dev) {
   uint32_t itime;
-  switch (als21c_data.int_time) {
+  switch (dev->data.int_time) {
     case ALS21C_INT_TIME_1T: itime = 1; break;
     case ALS21C_INT_TIME_4T: itime = 4; break;
     case ALS21C_INT_TIME_16T: itime = 16; break;
     case ALS21C_INT_TIME_64T: itime = 64; break;
     default: itime = 1; break; /* should never happen */
   }
-  itime = itime * (als21c_data.als_conv + 1);
+  itime = itime * (dev->data.als_conv + 1);
   return itime;
 }
 
-/*!
- * @brief  set the integration time for the ADC in milliseconds
- * @param  millisec
- *         integration time in milliseconds
- */
-void als21c_set_integration_time_millisec(uint32_t millisec) {
-  uint32_t count;
-  count = (millisec * 416) / 487; /* 416/487 = 1.17ms */
-  als21c_set_integration_time(count);
-}
-
 /*!
  * @brief  get the integration time for the ADC in milliseconds
  * @param  none
  * @return integration time in milliseconds
  */
-uint32_t als21c_get_integration_time_millisec(void) {
+uint32_t als21c_get_integration_time_millisec(als21c_dev_t *dev) {
   uint32_t count, millisec;
-  count = als21c_get_integration_time();
+  count = als21c_get_integration_time(dev);
   millisec = (count * 487) / 416; /* 416/487 = 1.17ms */
   return millisec;
 }
@@ -287,56 +235,24 @@ uint32_t als21c_get_integration_time_millisec(void) {
  * @param  none
  * @return maximum ALS count
  */
-int32_t als21c_get_max_count(void) {
+int32_t als21c_get_max_count(als21c_dev_t *dev) {
   int32_t max_count, integration_time;
-  integration_time = als21c_get_integration_time();
+  integration_time = als21c_get_integration_time(dev);
   max_count = 1024 * integration_time - 1;
   if (max_count > 0xffff) max_count = 0xffff;
   return max_count;
 }
 
-/*!
- * @brief  set the wait time between two measurements
- * @param  millisec
- */
-void als21c_set_wait(als21c_wait_time_t unit, uint8_t count) {
-  als21c_data.wtime_unit = unit;
-  als21c_data.wtime = count;
-  als21c_set_reg_wait_time();
-}
-
-/*!
- * @brief  set the wait time between two measurements in milliseconds
- * @param  millisec
- *         wait time 0 switches waiting off
- */
-void als21c_set_wait_time_millisec(uint16_t millisec) {
-
-  if (millisec <= 8) als21c_set_wait(ALS21C_WAIT_TIME_1T, 0);
-  else if (millisec <= 512) als21c_set_wait(ALS21C_WAIT_TIME_1T, millisec / 8 - 1);
-  else if (millisec <= 1024) als21c_set_wait(ALS21C_WAIT_TIME_2T, millisec / 16 - 1);
-  else if (millisec <= 2048) als21c_set_wait(ALS21C_WAIT_TIME_4T, millisec / 32 - 1);
-  else if (millisec <= 4096) als21c_set_wait(ALS21C_WAIT_TIME_8T, millisec / 64 - 1);
-  else als21c_set_wait(ALS21C_WAIT_TIME_8T, 0x3f); /* maximum value */
-
-  /* disable wait if millisec == 0 */
-  if (millisec == 0)
-    als21c_data.en_wait = 0x0;
-  else
-    als21c_data.en_wait = 0x1;
-  als21c_set_reg_sysm_ctrl();
-}
-
 /*!
  * @brief  return wait time in millis between two measurements
  * @return millisec
  */
-uint32_t als21c_get_wait_time_millisec() {
+uint32_t als21c_get_wait_time_millisec(als21c_dev_t *dev) {
   uint32_t wtime, millisec;
   millisec = 0;
-  if (als21c_data.en_wait) {
-    wtime = 8 << als21c_data.wtime_unit;
-    millisec = wtime * (als21c_data.wtime + 1);
+  if (dev->data.en_wait) {
+    wtime = 8 << dev->data.wtime_unit;
+    millisec = wtime * (dev->data.wtime + 1);
   }
   return millisec;
 }
@@ -346,107 +262,530 @@ uint32_t als21c_get_wait_time_millisec() {
  * @return millisec
  *         sum of integration time and wait time
  */
-uint32_t als21c_get_delay_millisec() {
+uint32_t als21c_get_delay_millisec(als21c_dev_t *dev) {
   uint32_t millisec;
-  millisec = als21c_get_integration_time_millisec() + als21c_get_wait_time_millisec();
+  millisec = als21c_get_integration_time_millisec(dev) + als21c_get_wait_time_millisec(dev);
   return millisec;
 }
 
+/*
+ * stale samples.
+ * a change of gain or integration time does not stop the integration
+ * that is running; that sample is measured with the old configuration.
+ * the first sample with the new configuration is ready at most one old
+ * integration, one wait and one new integration after the write.
+ * before that, a sample is either from the old configuration, if read
+ * sooner than one new integration after the write, or unknown.
+ * times are microseconds, and wrap around.
+ * the sensor clock is taken to be accurate to 1/8.
+ */
+
 /*!
- * @brief  return raw ALS count
- * @return count
- *         positive or zero value is als count
- *         negative value is error condition
- *         ALS21C_ERR_SATURATION: error in the analog part (amplifier, comparator)
- *         ALS21C_ERR_NOT_READY: reading too soon (sensor still counting)
+ * @brief  record a write of gain, integration time, wait time or enable
+ * @param  t0_us
+ *         time, before the write
+ * @param  t1_us
+ *         time, after the write
  */
-int32_t als21c_read_als() {
-  uint16_t count;
-  als21c_get_reg_data_status();
-  if (!als21c_data.data_ready) return ALS21C_ERR_NOT_READY;
-  if (als21c_data.saturation_als || als21c_data.saturation_comp) return ALS21C_ERR_SATURATION;
-  count = als21c_i2c_read16(ALS21C_REG_ALS_DATA);
-  return count;
+void als21c_config_changed(als21c_dev_t *dev, uint32_t t0_us, uint32_t t1_us) {
+  uint32_t gain = als21c_get_gain_value(dev);
+  uint32_t itime = als21c_get_integration_time(dev);
+  uint32_t int_us = itime * ALS21C_INT_TIME_US;
+  uint32_t wait_us = als21c_get_wait_time_millisec(dev) * 1000;
+  uint32_t end_us, span_us;
+  bool pending = dev->config_pending && (int32_t)(t0_us - dev->config_ready_us) < 0;
+
+  /* end of the integration running now */
+  end_us = t1_us + dev->config_int_us + dev->config_int_us / 8;
+  if (pending && (int32_t)(dev->config_ready_us - end_us) > 0)
+    end_us = dev->config_ready_us;
+  span_us = (wait_us > dev->config_wait_us ? wait_us : dev->config_wait_us) + int_us;
+
+  /* samples read before one new integration after the write are from the old configuration */
+  if (!pending) {
+    dev->config_old_gain = dev->config_gain;
+    dev->config_old_itime = dev->config_itime;
+    dev->config_old_us = t0_us + int_us - int_us / 8;
+  } else if ((int32_t)(t0_us - dev->config_old_us) < 0) {
+    /* no sample with the intermediate configuration yet; old configuration stays */
+    if ((int32_t)(t0_us + int_us - int_us / 8 - dev->config_old_us) < 0)
+      dev->config_old_us = t0_us + int_us - int_us / 8;
+  } else {
+    /* sample in flight may be from any configuration */
+    dev->config_old_gain = 0;
+  }
+  dev->config_gain = gain;
+  dev->config_itime = itime;
+  dev->config_int_us = int_us;
+  dev->config_wait_us = wait_us;
+  dev->config_ready_us = end_us + span_us + span_us / 8;
+  dev->config_pending = true;
+  dev->config_gen++;
 }
 
-void als21c_increase_gain() {
-  if (als21c_data.pd_sel == 0) {
-    /* double gain */
-    als21c_data.pd_sel = 1;
-    als21c_set_reg_als_gain();
-  } else if (als21c_data.pga_als != ALS21C_GAIN_256X) {
-    /* more gain */
-    als21c_data.pga_als <<= 1;
-    als21c_data.pd_sel = 0;
-    als21c_set_reg_als_gain();
-  } else if (als21c_data.int_time != ALS21C_INT_TIME_64T) {
-    /* increase int_time */
-    als21c_data.int_time++;
-    als21c_set_reg_als_time();
-  } else if (als21c_data.als_conv < 15) {
-    /* increase als_conv */
-    als21c_data.als_conv++;
-    als21c_set_reg_als_time();
+/*!
+ * @brief  record the start of a measurement while the sensor was idle
+ * @param  t1_us
+ *         time, after the write
+ *         nothing is in flight; the first sample is ready one integration after the start.
+ */
+void als21c_config_started(als21c_dev_t *dev, uint32_t t1_us) {
+  dev->config_old_gain = 0;
+  dev->config_ready_us = t1_us + dev->config_int_us + dev->config_int_us / 8;
+  dev->config_pending = true;
+}
+
+/*!
+ * @brief  configuration a sample was measured with
+ * @param  t0_us
+ *         time, before the sample was read
+ * @param  t1_us
+ *         time, after the sample was read
+ * @return ALS21C_SAMPLE_NEW, ALS21C_SAMPLE_OLD or ALS21C_SAMPLE_STALE
+ */
+als21c_sample_t als21c_sample_config(als21c_dev_t *dev, uint32_t t0_us, uint32_t t1_us) {
+  if (!dev->config_pending) return ALS21C_SAMPLE_NEW;
+  if ((int32_t)(t0_us - dev->config_ready_us) >= 0) {
+    dev->config_pending = false;
+    return ALS21C_SAMPLE_NEW;
   }
+  if (dev->config_old_gain != 0 && (int32_t)(t1_us - dev->config_old_us) < 0)
+    return ALS21C_SAMPLE_OLD;
+  return ALS21C_SAMPLE_STALE;
 }
 
-void als21c_decrease_gain() {
-  if (als21c_data.als_conv > 0) {
-    /* decrease als_conv */
-    --als21c_data.als_conv;
-    als21c_set_reg_als_time();
-  } else if (als21c_data.int_time != ALS21C_INT_TIME_1T) {
-    /* decrease int_time */
-    --als21c_data.int_time;
-    als21c_set_reg_als_time();
-  } else if (als21c_data.pd_sel == 1) {
-    /* halve gain */
-    als21c_data.pd_sel = 0;
-    als21c_set_reg_als_gain();
-  } else if (als21c_data.pga_als != ALS21C_GAIN_1X) {
-    /* less gain */
-    als21c_data.pga_als >>= 1;
-    als21c_data.pd_sel = 1;
-    als21c_set_reg_als_gain();
+/*
+ * sample timing.
+ * in continuous measurement, with als21c_track_t attached, the deadline
+ * tracks the time samples become ready. A read that finds no sample
+ * ready, followed by one that does, brackets that time, the edge, of the
+ * sample after the last one read. That sample is ready at most one period
+ * after the last one read, which narrows the bracket when reads take most
+ * of a period, as at 100 kHz.
+ * Samples are numbered on the sensor clock. The first edge is the
+ * reference of the grid: sample ref_n became ready between ref_lo_us and
+ * ref_hi_us, and the period is between period_min and period_max, at
+ * first nominal +/- 1/8. A sample read is numbered from its place on the
+ * grid: the lowest and highest number it can have. The read narrows both
+ * the reference and the period: the lowest numbered sample was ready, the
+ * one after the highest was not. So does a read that finds no sample
+ * ready. The reference stays while samples are lost, and the period is
+ * measured over more samples as time goes on. The samples skipped by the
+ * lowest numbers are the samples certainly lost, dropped; by the highest,
+ * the samples lost at most, dropped_max. A number too low is made up by
+ * the next read that knows better. When reads take most of a period, the
+ * reads may not tell one lost sample from a slower sensor clock, and the
+ * two counts differ.
+ * The deadlines go by the clock, not by the sample numbers.
+ * Between edges, the deadline moves earlier by a little more every sample,
+ * so that a read finds no sample ready again and the edge is found again,
+ * also if the sensor runs faster than measured.
+ * Without grid, the next read starts half a period after this one, and
+ * the gap between two reads gives both counts.
+ * Without tracker, the deadline is one nominal period after the previous one.
+ */
+
+/* period from integration and wait time */
+static uint32_t als21c_meas_nominal(als21c_dev_t *dev) {
+  return als21c_get_integration_time(dev) * ALS21C_INT_TIME_US + als21c_get_wait_time_millisec(dev) * 1000;
+}
+
+/* period_us and period_err from period_min and period_max */
+static void als21c_meas_period(als21c_track_t *track) {
+  track->period_us = (track->period_min + track->period_max + 64) / 128;
+  track->period_err = (track->period_max - track->period_min + 127) / 128;
+  track->measured = track->period_err * 1024 <= track->period_us;
+}
+
+/* period nominal +/- 1/8, no grid */
+static void als21c_meas_clear(als21c_dev_t *dev, als21c_track_t *track) {
+  uint32_t nominal = als21c_meas_nominal(dev);
+  track->period_min = nominal * 56;
+  track->period_max = nominal * 72;
+  als21c_meas_period(track);
+  track->early = false;
+  track->grid = false;
+}
+
+/* sample n became ready after t_us. narrows reference and period */
+static void als21c_meas_after(als21c_track_t *track, uint32_t n, uint32_t t_us) {
+  uint32_t k = n - track->ref_n, lo, p;
+  if ((int32_t)(t_us - track->ref_hi_us) > 0 && k != 0) {
+    p = (t_us - track->ref_hi_us) * 64 / k;
+    if (p > track->period_max) p = track->period_max;
+    if (p > track->period_min) track->period_min = p;
+  }
+  lo = t_us - (k * track->period_max + 63) / 64;
+  if ((int32_t)(lo - track->ref_hi_us) > 0) lo = track->ref_hi_us;
+  if ((int32_t)(lo - track->ref_lo_us) > 0) track->ref_lo_us = lo;
+}
+
+/* sample n was ready at t_us. narrows reference and period */
+static void als21c_meas_before(als21c_track_t *track, uint32_t n, uint32_t t_us) {
+  uint32_t k = n - track->ref_n, hi, p;
+  if (k != 0) {
+    p = ((t_us - track->ref_lo_us) * 64 + k - 1) / k;
+    if (p < track->period_min) p = track->period_min;
+    if (p < track->period_max) track->period_max = p;
   }
+  hi = t_us - k * track->period_min / 64;
+  if ((int32_t)(hi - track->ref_lo_us) < 0) hi = track->ref_lo_us;
+  if ((int32_t)(hi - track->ref_hi_us) < 0) track->ref_hi_us = hi;
 }
 
 /*!
- * @brief  return ALS light intensity in lux
- * @return lux
- *         positive or zero value is lux
- *         negative value is error condition
- *         ALS21C_ERR_SATURATION: error in the analog part (amplifier, comparator)
- *         ALS21C_ERR_OVERFLOW: error in the digital part (counter)
- *         ALS21C_ERR_NOT_READY: reading too soon (sensor still counting)
+ * @brief  attach sample tracking to a sensor, or detach with NULL
+ * @param  track
+ *         owned by the caller, as long as attached
  */
-int32_t als21c_read_lux() {
-  int32_t count, max_count;
-  int32_t lux;
+void als21c_set_track(als21c_dev_t *dev, als21c_track_t *track) {
+  dev->track = track;
+  if (track != NULL) {
+    memset(track, 0, sizeof(*track));
+    als21c_meas_clear(dev, track);
+  }
+}
+
+/*!
+ * @brief  sample period
+ * @return microseconds. measured if tracked, else from integration and wait time.
+ */
+uint32_t als21c_get_period(als21c_dev_t *dev) {
+  return dev->track != NULL ? dev->track->period_us : als21c_meas_nominal(dev);
+}
+
+/*!
+ * @brief  start sample timing anew, after start or configuration change
+ */
+void als21c_meas_restart(als21c_dev_t *dev) {
+  als21c_track_t *track = dev->track;
+  if (track == NULL) return;
+  als21c_meas_clear(dev, track);
+  track->samples = 0;
+  track->dropped = 0;
+  track->dropped_max = 0;
+}
+
+/*!
+ * @brief  a read found no sample ready. sets the deadline to try again.
+ * @param  t0_us
+ *         time, before the read
+ * @param  t1_us
+ *         time, after the read
+ */
+void als21c_meas_early(als21c_dev_t *dev, uint32_t t0_us, uint32_t t1_us) {
+  als21c_track_t *track = dev->track;
+  if (track == NULL) {
+    dev->meas_deadline_us = t1_us + als21c_meas_nominal(dev) / 8;
+    return;
+  }
+  if (track->grid && track->samples != 0 && t0_us - track->ref_lo_us < 0x2000000) {
+    als21c_meas_after(track, track->last_max + 1, t0_us);
+    als21c_meas_period(track);
+  }
+  track->early = true;
+  track->early_us = t0_us;
+  dev->meas_deadline_us = t1_us + track->period_us / 16;
+}
+
+/*!
+ * @brief  a read found a sample. sets the deadline of the next sample.
+ * @param  t0_us
+ *         time, before the read
+ * @param  t1_us
+ *         time, after the read
+ */
+void als21c_meas_sampled(als21c_dev_t *dev, uint32_t t0_us, uint32_t t1_us) {
+  als21c_track_t *track = dev->track;
+  uint32_t period, upper, lo, hi, since, bias, n, n_max, last_n, last_max;
+  int32_t d;
+
+  if (track == NULL) {
+    /* one period after the previous deadline; the margin is already in there */
+    period = als21c_meas_nominal(dev);
+    dev->meas_deadline_us += period;
+    if ((int32_t)(dev->meas_deadline_us - t1_us) < 0) dev->meas_deadline_us = t1_us + period;
+    return;
+  }
 
-  als21c_get_reg_data_status();
-  if (!als21c_data.data_ready) return ALS21C_ERR_NOT_READY;
+  if (track->samples == 0) {
+    track->last_n = 0;
+    track->last_max = 0;
+    track->early = false;
+  }
+  /* 64 * microseconds since the reference must fit in 32 bits */
+  if (track->grid && t0_us - track->ref_lo_us >= 0x2000000) track->grid = false;
+
+  if (track->early) {
+    /* the sample after the last one read became ready after the early read, and at most a period after the last one read */
+    upper = track->last_us + (track->period_max + 63) / 64;
+    if ((int32_t)(upper - t0_us) > 0 || (int32_t)(upper - track->early_us) < 0) upper = t0_us;
+    n = track->last_n + 1;
+    if (!track->grid || t0_us - track->ref_lo_us >= 0x1000000) {
+      /* new reference: at the first edge, and before the microseconds no longer fit */
+      lo = track->early_us;
+      hi = upper;
+      if (track->grid && track->last_max == track->last_n) {
+        /* where the grid puts this sample. a little slack for drift */
+        since = n - track->ref_n;
+        if ((int32_t)(track->ref_lo_us + since * track->period_min / 64 - lo) > 0) lo = track->ref_lo_us + since * track->period_min / 64;
+        if ((int32_t)(track->ref_hi_us + (since * track->period_max + 63) / 64 - hi) < 0) hi = track->ref_hi_us + (since * track->period_max + 63) / 64;
+        if ((int32_t)(hi - lo) < 0) hi = lo;
+        track->period_min--;
+        track->period_max++;
+      }
+      track->ref_lo_us = lo;
+      track->ref_hi_us = hi;
+      track->ref_n = n;
+      track->last_max = track->last_n;
+      track->grid = true;
+    }
+    track->edge_us = track->early_us + (upper - track->early_us) / 2;
+  }
 
-  count = als21c_i2c_read16(ALS21C_REG_ALS_DATA);
-  max_count = als21c_get_max_count();
+  /* number of this sample: the last one ready at t0. at least n, at most n_max */
+  last_n = track->last_n;
+  last_max = track->last_max;
+  n = last_n + 1;
+  n_max = n;
+  if (track->samples == 0) {
+    n = 0;
+    n_max = 0;
+  } else if (track->grid) {
+    since = (int32_t)(t0_us - track->ref_hi_us) > 0 ? (t0_us - track->ref_hi_us) * 64 / track->period_max : 0;
+    if ((int32_t)(track->ref_n + since - n) > 0) n = track->ref_n + since;
+    n_max = track->ref_n + (t0_us - track->ref_lo_us) * 64 / track->period_min;
+    if ((int32_t)(n_max - n) < 0) n_max = n;
+  } else {
+    /* from the gap between reads: the samples certainly lost, sensor clock within 1/8 */
+    since = t0_us - track->last_us;
+    if (since > 2 * track->period_us + track->period_us / 4) n += (since - track->period_us / 4) / track->period_us - 1;
+    n_max = last_max + since / (track->period_min / 64) + 1;
+    if ((int32_t)(n_max - n) < 0) n_max = n;
+  }
+  /* the lowest number. sample n was ready, sample n_max + 1 was not */
+  if (track->grid) {
+    als21c_meas_before(track, n, t0_us);
+    als21c_meas_after(track, n_max + 1, t0_us);
+    als21c_meas_period(track);
+  }
+  if (track->samples != 0) {
+    track->dropped += n - last_n - 1;
+    track->dropped_max += n_max - last_max - 1;
+  }
+  track->samples++;
+  track->last_us = t0_us;
+  track->last_n = n;
+  track->last_max = n_max;
+  period = track->period_us;
+
+  if (!track->grid) {
+    dev->meas_deadline_us = t0_us + period / 2;
+  } else if (track->early) {
+    /* the edge after this read */
+    dev->meas_deadline_us = track->edge_us + ((t0_us - track->edge_us) / period + 1) * period + period / 32;
+  } else {
+    /* period not yet known well: more */
+    since = (t0_us - track->edge_us) / period;
+    if (since > 0xffff) since = 0xffff;
+    bias = (since * period) >> (track->measured || n - track->ref_n >= 64 ? 10 : 8);
+    if (bias > period / 2) bias = period / 2;
+    d = (int32_t)(t0_us - dev->meas_deadline_us);
+    dev->meas_deadline_us += ((d < 0 ? 0 : (uint32_t)d / period) + 1) * period - bias;
+  }
+  track->early = false;
+
+  /* behind: read again as soon as possible */
+  if ((int32_t)(dev->meas_deadline_us - t1_us) < 0) dev->meas_deadline_us = t1_us;
+}
+
+/*
+ * interrupt pipeline.
+ * two single-producer, single-consumer queues with free-running 8-bit
+ * indices. The producer writes the entry, then publishes head with
+ * release semantics; the consumer reads head with acquire semantics.
+ * no locks, and no disabling of interrupts.
+ */
+
+#define ALS21C_LOAD_ACQUIRE(p) __atomic_load_n(p, __ATOMIC_ACQUIRE)
+#define ALS21C_STORE_RELEASE(p, v) __atomic_store_n(p, v, __ATOMIC_RELEASE)
+
+/*!
+ * @brief  initialize interrupt pipeline. does not access the sensor.
+ */
+void als21c_irq_init(als21c_irq_t *irq, als21c_dev_t *dev) {
+  memset(irq, 0, sizeof(*irq));
+  irq->dev = dev;
+  irq->hyst_percent = ALS21C_IRQ_HYST_PERCENT;
+  irq->pers = irq->pers_min = 1;
+  irq->prev_lux = -1;
+}
+
+/*!
+ * @brief  set threshold window
+ * @param  lux
+ *         window is at least lux above and below the last reading
+ * @param  percent
+ *         window is at least percent above and below the last reading
+ */
+void als21c_irq_set_hysteresis(als21c_irq_t *irq, uint32_t lux, uint8_t percent) {
+  irq->hyst_lux = lux;
+  irq->hyst_percent = percent;
+}
+
+/* half width of window around lux */
+static uint32_t als21c_irq_half_width(als21c_irq_t *irq, int32_t lux) {
+  uint32_t rel = (uint64_t)lux * irq->hyst_percent / 100;
+  return rel > irq->hyst_lux ? rel : irq->hyst_lux;
+}
+
+/*!
+ * @brief  move the window to a new reading, and tune persistence
+ * @param  lux
+ *         reading, or negative error
+ * @param  t_us
+ *         time of reading
+ *         a reading back inside the window before the last one is noise or
+ *         flicker: one more measurement of persistence, up to ALS21C_IRQ_PERS_MAX.
+ */
+void als21c_irq_update(als21c_irq_t *irq, int32_t lux, uint32_t t_us) {
+  if (lux < 0) {
+    irq->window = ALS21C_WINDOW_SATURATED;
+    irq->prev_lux = -1;
+    return;
+  }
+  if (irq->window == ALS21C_WINDOW_LUX && irq->prev_lux >= 0) {
+    uint32_t diff = lux > irq->prev_lux ? lux - irq->prev_lux : irq->prev_lux - lux;
+    if (diff <= als21c_irq_half_width(irq, irq->prev_lux) && irq->pers < ALS21C_IRQ_PERS_MAX)
+      irq->pers++;
+  }
+  irq->prev_lux = irq->window == ALS21C_WINDOW_LUX ? irq->centre_lux : -1;
+  irq->centre_lux = lux;
+  irq->centre_us = t_us;
+  irq->window = ALS21C_WINDOW_LUX;
+}
+
+/*!
+ * @brief  lower persistence after a quiet spell
+ * @param  now_us
+ * @return true if persistence changed
+ *         after ALS21C_IRQ_QUIET persistence periods without interrupt,
+ *         one less, down to the persistence of als21c_irq_enable().
+ */
+bool als21c_irq_relax(als21c_irq_t *irq, uint32_t now_us) {
+  als21c_dev_t *dev = irq->dev;
+  uint32_t period_us;
+  if (irq->pers <= irq->pers_min) return false;
+  period_us = als21c_get_integration_time(dev) * ALS21C_INT_TIME_US + als21c_get_wait_time_millisec(dev) * 1000;
+  if (now_us - irq->centre_us < ALS21C_IRQ_QUIET * irq->pers * period_us) return false;
+  irq->pers--;
+  irq->centre_us = now_us;
+  return true;
+}
 
-  /* convert adc count to lux */
-  lux = als21c_count_to_lux(count);
+/*!
+ * @brief  thresholds in counts, with current gain and integration time
+ * @param  low
+ * @param  high
+ */
+void als21c_irq_window(als21c_irq_t *irq, uint16_t *low, uint16_t *high) {
+  als21c_dev_t *dev = irq->dev;
+  int32_t max_count = als21c_get_max_count(dev);
+  int32_t count, lo, hi;
+  uint32_t half;
+
+  switch (irq->window) {
+    case ALS21C_WINDOW_LUX:
+      half = als21c_irq_half_width(irq, irq->centre_lux);
+      count = als21c_lux_to_count(dev, irq->centre_lux);
+      lo = irq->centre_lux > (int32_t)half ? als21c_lux_to_count(dev, irq->centre_lux - half) : 0;
+      hi = als21c_lux_to_count(dev, irq->centre_lux + half);
+      /* at least ALS21C_IRQ_WINDOW_MIN counts: quantization noise */
+      if (lo > count - ALS21C_IRQ_WINDOW_MIN) lo = count - ALS21C_IRQ_WINDOW_MIN;
+      if (hi < count + ALS21C_IRQ_WINDOW_MIN) hi = count + ALS21C_IRQ_WINDOW_MIN;
+      if (lo < 0) lo = 0;
+      if (hi > 0xffff) hi = 0xffff;
+      *low = lo;
+      *high = hi;
+      break;
+    case ALS21C_WINDOW_SATURATED:
+      /* interrupt when the count is back in range */
+      *low = max_count - max_count / 4;
+      *high = 0xffff;
+      break;
+    default:
+      /* every count is outside */
+      *low = 0xffff;
+      *high = 0;
+      break;
+  }
+}
 
-  /* automatic configuration of gain and integration time */
-  if (als21c_data.auto_lux) {
-    if (als21c_data.saturation_als || als21c_data.saturation_comp || (count > max_count - max_count / 4))
-      als21c_decrease_gain();
-    else if (count < max_count / 4)
-      als21c_increase_gain();
+/*!
+ * @brief  queue an interrupt. Call from the interrupt handler.
+ * @param  t_us
+ *         time of interrupt, microseconds
+ */
+void als21c_irq_event(als21c_irq_t *irq, uint32_t t_us) {
+  uint8_t head = irq->event_head;
+  uint8_t tail = ALS21C_LOAD_ACQUIRE(&irq->event_tail);
+  if ((uint8_t)(head - tail) >= ALS21C_IRQ_EVENTS) {
+    irq->event_overruns++;
+    return;
   }
+  irq->event_us[head & (ALS21C_IRQ_EVENTS - 1)] = t_us;
+  ALS21C_STORE_RELEASE(&irq->event_head, (uint8_t)(head + 1));
+}
+
+/*!
+ * @brief  true if interrupts are queued
+ */
+bool als21c_irq_pending(als21c_irq_t *irq) {
+  return ALS21C_LOAD_ACQUIRE(&irq->event_head) != irq->event_tail;
+}
+
+/*!
+ * @brief  take all queued interrupts
+ * @param  t_us
+ *         time of the last interrupt
+ * @return false if no interrupts queued
+ *         the sensor only holds the last sample; interrupts queued
+ *         before that one are taken together.
+ */
+bool als21c_irq_next_event(als21c_irq_t *irq, uint32_t *t_us) {
+  uint8_t head = ALS21C_LOAD_ACQUIRE(&irq->event_head);
+  uint8_t tail = irq->event_tail;
+  if (head == tail) return false;
+  *t_us = irq->event_us[(uint8_t)(head - 1) & (ALS21C_IRQ_EVENTS - 1)];
+  ALS21C_STORE_RELEASE(&irq->event_tail, head);
+  return true;
+}
 
-  if (als21c_data.saturation_als || als21c_data.saturation_comp)
-    return ALS21C_ERR_SATURATION; /* analog */
-  else if (count >= max_count)
-    return ALS21C_ERR_OVERFLOW; /* digital */
+/*!
+ * @brief  queue a reading for the consumer
+ */
+void als21c_irq_push(als21c_irq_t *irq, const als21c_reading_t *reading) {
+  uint8_t head = irq->reading_head;
+  uint8_t tail = ALS21C_LOAD_ACQUIRE(&irq->reading_tail);
+  if ((uint8_t)(head - tail) >= ALS21C_IRQ_READINGS) {
+    irq->reading_overruns++;
+    return;
+  }
+  irq->reading[head & (ALS21C_IRQ_READINGS - 1)] = *reading;
+  ALS21C_STORE_RELEASE(&irq->reading_head, (uint8_t)(head + 1));
+}
 
-  return lux;
+/*!
+ * @brief  take the oldest reading
+ * @return false if no readings queued
+ */
+bool als21c_irq_read(als21c_irq_t *irq, als21c_reading_t *reading) {
+  uint8_t head = ALS21C_LOAD_ACQUIRE(&irq->reading_head);
+  uint8_t tail = irq->reading_tail;
+  if (head == tail) return false;
+  *reading = irq->reading[tail & (ALS21C_IRQ_READINGS - 1)];
+  ALS21C_STORE_RELEASE(&irq->reading_tail, (uint8_t)(tail + 1));
+  return true;
 }
 
 /*!
@@ -454,139 +793,584 @@ int32_t als21c_read_lux() {
  * @param  onoff enable or disable
  *         when enabled, automatically adjusts ALS gain and integration time
  */
-void als21c_set_auto_lux(bool onoff) {
-  als21c_data.auto_lux = onoff;
+void als21c_set_auto_lux(als21c_dev_t *dev, bool onoff) {
+  dev->data.auto_lux = onoff ? ALS21C_AUTO_LUX_STEP : ALS21C_AUTO_LUX_OFF;
 }
 
 /*!
- * @brief  enable or disable interrupt
- * @param  onoff
+ * @brief  set auto lux mode
+ * @param  mode
+ *         ALS21C_AUTO_LUX_OFF: fixed gain and integration time
+ *         ALS21C_AUTO_LUX_STEP: one step more or less gain per reading
+ *         ALS21C_AUTO_LUX_PREDICT: from the reading, predict the best range and go there in one step
  */
-void als21c_enable_interrupt(bool onoff) {
-  als21c_data.en_aint = onoff ? 0x1 : 0x0;
-  als21c_set_reg_int_ctrl();
+void als21c_set_auto_lux_mode(als21c_dev_t *dev, als21c_auto_lux_t mode) {
+  dev->data.auto_lux = mode;
 }
 
+/*
+ * ranges, in order of increasing sensitivity.
+ * same order as als21c_increase_gain(): first gain, then integration time.
+ * 0..9: gain 1..512, integration time 1T
+ * 10..12: gain 512, integration time 4T, 16T, 64T
+ * 13..27: gain 512, integration time 64T * 2 .. 64T * 16
+ */
+
 /*!
- * @brief  set ALS synchronisation
- * @param  onoff
- *         when enabled, ALS light measurement waits until interrupt is cleared
+ * @brief  gain of range
  */
-void als21c_enable_als_sync(bool onoff) {
-  als21c_data.als_sync = onoff ? 0x1 : 0x0;
-  als21c_set_reg_int_ctrl();
+uint32_t als21c_range_gain(uint8_t range) {
+  if (range < 10) return 1u << range;
+  return 512;
 }
 
 /*!
- * @brief  get ALS interrupt status
- * @return true if interrupt pending
+ * @brief  integration time of range, in units of 1.17 milliseconds
  */
-bool als21c_interrupt_status() {
-  als21c_get_reg_int_flag();
-  return als21c_data.int_por || als21c_data.int_als;
+uint32_t als21c_range_integration_time(uint8_t range) {
+  if (range < 10) return 1;
+  if (range < 13) return 1u << (2 * (range - 9));
+  if (range > ALS21C_RANGE_MAX) range = ALS21C_RANGE_MAX;
+  return 64 * (range - 11);
+}
+
+/* counts per normalized count; gain * integration time */
+static uint32_t als21c_range_sensitivity(uint8_t range) {
+  return als21c_range_gain(range) * als21c_range_integration_time(range);
+}
+
+/* most sensitive range with sensitivity at most sens */
+static uint8_t als21c_range_below(uint32_t sens) {
+  uint8_t range = 0;
+  while (range < ALS21C_RANGE_MAX && als21c_range_sensitivity(range + 1) <= sens)
+    range++;
+  return range;
+}
+
+/* integer square root */
+static uint32_t als21c_isqrt(uint32_t n) {
+  uint32_t root = 0, bit = 1ul << 30;
+  while (bit > n) bit >>= 2;
+  while (bit != 0) {
+    if (n >= root + bit) {
+      n -= root + bit;
+      root = (root >> 1) + bit;
+    } else {
+      root >>= 1;
+    }
+    bit >>= 2;
+  }
+  return root;
 }
 
 /*!
- * @brief  clear ALS interrupt
+ * @brief  current range
+ * @return range with same or next lower sensitivity as current gain and integration time
  */
-void als21c_clear_interrupt() {
-  als21c_i2c_write8(ALS21C_REG_INT_FLAG, 0x0);
+uint8_t als21c_get_range(als21c_dev_t *dev) {
+  return als21c_range_below(als21c_get_gain_value(dev) * als21c_get_integration_time(dev));
 }
 
 /*!
- * @brief  set interrupt persistence
- * @param  pers
- *         sets number of consecutive measurements that have to be outside threshold to trigger an interrupt
- *         if pers is zero, thresholds are ignored and every measurement triggers an interrupt
+ * @brief  predict best range for a reading
+ * @param  count
+ *         ALS count, read with current gain and integration time
+ * @param  saturated
+ *         reading saturated. count is not valid.
+ * @return new range, or -1 if current gain and integration time are fine.
+ *         the new range gives a count between 1/4 and 3/4 of maximum count,
+ *         with the shortest integration time.
+ *         if saturated, a bracketing search: halfway, geometrically,
+ *         between current and least sensitive range.
  */
-void als21c_set_persistence(uint8_t pers) {
-  if (pers > 15) pers = 15;
-  als21c_data.prs_als = pers;
-  als21c_set_reg_persistence();
+int8_t als21c_auto_lux_range(als21c_dev_t *dev, uint16_t count, bool saturated) {
+  uint32_t sens = als21c_get_gain_value(dev) * als21c_get_integration_time(dev);
+  int32_t max_count = als21c_get_max_count(dev);
+  uint8_t current = als21c_range_below(sens);
+  int8_t range, best;
+
+  if (saturated || count >= max_count) {
+    range = als21c_range_below(als21c_isqrt(sens));
+    if (range >= current) range = current - 1;
+    return range;
+  }
+
+  /* good reading */
+  if (count >= max_count / 4 && count <= max_count - max_count / 4) return -1;
+
+  /*
+   * least sensitive range, i.e. shortest integration time, where the
+   * expected count is between 1/4 and 3/4 of maximum. If no range gets
+   * there, the most sensitive range that does not overflow.
+   * a count of 0 is taken as 1/2.
+   */
+  best = 0;
+  for (range = 0; range <= ALS21C_RANGE_MAX; range++) {
+    uint32_t itime = als21c_range_integration_time(range);
+    uint32_t range_max = itime >= 64 ? 0xffff : 1024 * itime - 1;
+    uint64_t expected = ((uint64_t)count * 2 + 1) * als21c_range_sensitivity(range) / (2 * sens);
+    if (expected > range_max - range_max / 4) break;
+    best = range;
+    if (expected >= range_max / 4) break;
+  }
+  range = best;
+  if (range == current && sens == als21c_range_sensitivity(current)) return -1;
+  return range;
+}
+
+/* driver core with the transport of this build */
+
+typedef als21c_driver<als21c_transport> driver;
+
+bool als21c_begin(als21c_dev_t *dev) {
+  return driver::begin(dev);
+}
+
+void als21c_end(als21c_dev_t *dev) {
+  driver::end(dev);
+}
+
+void als21c_reset(als21c_dev_t *dev) {
+  driver::reset(dev);
+}
+
+void als21c_enable(als21c_dev_t *dev, bool onoff) {
+  driver::enable(dev, onoff);
+}
+
+void als21c_enable_once(als21c_dev_t *dev, bool onoff) {
+  driver::enable_once(dev, onoff);
+}
+
+void als21c_set_gain(als21c_dev_t *dev, uint8_t pdsel, als21c_gain_t pdals) {
+  driver::set_gain(dev, pdsel, pdals);
+}
+
+void als21c_set_gain_value(als21c_dev_t *dev, uint32_t gain) {
+  driver::set_gain_value(dev, gain);
+}
+
+void als21c_set_integration(als21c_dev_t *dev, als21c_int_time_t itime, uint8_t icount) {
+  driver::set_integration(dev, itime, icount);
+}
+
+void als21c_set_integration_time(als21c_dev_t *dev, uint32_t count) {
+  driver::set_integration_time(dev, count);
+}
+
+void als21c_set_integration_time_millisec(als21c_dev_t *dev, uint32_t millisec) {
+  driver::set_integration_time_millisec(dev, millisec);
+}
+
+void als21c_set_wait(als21c_dev_t *dev, als21c_wait_time_t unit, uint8_t count) {
+  driver::set_wait(dev, unit, count);
+}
+
+void als21c_set_wait_time_millisec(als21c_dev_t *dev, uint16_t millisec) {
+  driver::set_wait_time_millisec(dev, millisec);
+}
+
+void als21c_increase_gain(als21c_dev_t *dev) {
+  driver::increase_gain(dev);
+}
+
+void als21c_decrease_gain(als21c_dev_t *dev) {
+  driver::decrease_gain(dev);
+}
+
+void als21c_set_range(als21c_dev_t *dev, uint8_t range) {
+  driver::set_range(dev, range);
+}
+
+int32_t als21c_read_als(als21c_dev_t *dev) {
+  return driver::read_als(dev);
+}
+
+int32_t als21c_read_lux(als21c_dev_t *dev) {
+  return driver::read_lux(dev);
+}
+
+uint32_t als21c_micros(als21c_dev_t *dev) {
+  return driver::micros(dev);
+}
+
+uint32_t als21c_start(als21c_dev_t *dev, bool once) {
+  return driver::start(dev, once);
+}
+
+int32_t als21c_poll(als21c_dev_t *dev, uint32_t now_us) {
+  return driver::poll(dev, now_us);
 }
 
 /*!
- * @brief  set lower threshold for ALS count to trigger an interrupt
- * @param  value
+ * @brief  time the next sample is ready
+ * @return microseconds, in the clock of als21c_micros()
  */
+uint32_t als21c_get_deadline(als21c_dev_t *dev) {
+  return dev->meas_deadline_us;
+}
+
+uint32_t als21c_stream_start(als21c_dev_t *dev) {
+  return driver::stream_start(dev);
+}
+
+void als21c_enable_interrupt(als21c_dev_t *dev, bool onoff) {
+  driver::enable_interrupt(dev, onoff);
+}
+
+void als21c_enable_als_sync(als21c_dev_t *dev, bool onoff) {
+  driver::enable_als_sync(dev, onoff);
+}
+
+bool als21c_interrupt_status(als21c_dev_t *dev) {
+  return driver::interrupt_status(dev);
+}
+
+void als21c_clear_interrupt(als21c_dev_t *dev) {
+  driver::clear_interrupt(dev);
+}
+
+void als21c_set_persistence(als21c_dev_t *dev, uint8_t pers) {
+  driver::set_persistence(dev, pers);
+}
+
+void als21c_set_low_threshold(als21c_dev_t *dev, uint16_t value) {
+  driver::set_low_threshold(dev, value);
+}
+
+void als21c_set_high_threshold(als21c_dev_t *dev, uint16_t value) {
+  driver::set_high_threshold(dev, value);
+}
+
+void als21c_set_thresholds(als21c_dev_t *dev, uint16_t low, uint16_t high) {
+  driver::set_thresholds(dev, low, high);
+}
+
+void als21c_irq_enable(als21c_irq_t *irq, uint8_t pers) {
+  driver::irq_enable(irq, pers);
+}
+
+void als21c_irq_isr(als21c_irq_t *irq) {
+  driver::irq_isr(irq);
+}
+
+int als21c_irq_handle(als21c_irq_t *irq) {
+  return driver::irq_handle(irq);
+}
+
+uint16_t als21c_get_product_id(als21c_dev_t *dev) {
+  return driver::get_product_id(dev);
+}
+
+void als21c_commit(als21c_dev_t *dev) {
+  driver::commit(dev);
+}
+
+void als21c_set_reg_sysm_ctrl(als21c_dev_t *dev) {
+  driver::set_reg_sysm_ctrl(dev);
+}
+
+void als21c_set_reg_int_ctrl(als21c_dev_t *dev) {
+  driver::set_reg_int_ctrl(dev);
+}
+
+void als21c_set_reg_int_flag(als21c_dev_t *dev) {
+  driver::set_reg_int_flag(dev);
+}
+
+void als21c_get_reg_int_flag(als21c_dev_t *dev) {
+  driver::get_reg_int_flag(dev);
+}
+
+void als21c_set_reg_wait_time(als21c_dev_t *dev) {
+  driver::set_reg_wait_time(dev);
+}
+
+void als21c_set_reg_als_gain(als21c_dev_t *dev) {
+  driver::set_reg_als_gain(dev);
+}
+
+void als21c_set_reg_als_time(als21c_dev_t *dev) {
+  driver::set_reg_als_time(dev);
+}
+
+void als21c_set_reg_persistence(als21c_dev_t *dev) {
+  driver::set_reg_persistence(dev);
+}
+
+void als21c_get_reg_data_status(als21c_dev_t *dev) {
+  driver::get_reg_data_status(dev);
+}
+
+uint16_t als21c_get_reg_data(als21c_dev_t *dev) {
+  return driver::get_reg_data(dev);
+}
+
+/* I2C operations */
+
+void als21c_i2c_write8(als21c_dev_t *dev, const uint8_t reg, const uint8_t data) {
+  driver::write8(dev, reg, data);
+}
+
+void als21c_i2c_write16(als21c_dev_t *dev, const uint8_t reg, const uint16_t data) {
+  driver::write16(dev, reg, data);
+}
+
+uint8_t als21c_i2c_read8(als21c_dev_t *dev, const uint8_t reg) {
+  return driver::read8(dev, reg);
+}
+
+uint16_t als21c_i2c_read16(als21c_dev_t *dev, const uint8_t reg) {
+  return driver::read16(dev, reg);
+}
+
+bool als21c_i2c_read(als21c_dev_t *dev, const uint8_t reg, uint8_t *data, const uint8_t len) {
+  return driver::read(dev, reg, data, len);
+}
+
+bool als21c_i2c_write(als21c_dev_t *dev, const uint8_t reg, const uint8_t *data, const uint8_t len) {
+  return driver::write(dev, reg, data, len);
+}
+
+/* default sensor */
+
+bool als21c_begin() {
+  return als21c_begin(&als21c_dev);
+}
+
+void als21c_end() {
+  als21c_end(&als21c_dev);
+}
+
+void als21c_reset() {
+  als21c_reset(&als21c_dev);
+}
+
+void als21c_enable(bool onoff) {
+  als21c_enable(&als21c_dev, onoff);
+}
+
+void als21c_enable_once(bool onoff) {
+  als21c_enable_once(&als21c_dev, onoff);
+}
+
+void als21c_set_gain(uint8_t pdsel, als21c_gain_t pdals) {
+  als21c_set_gain(&als21c_dev, pdsel, pdals);
+}
+
+void als21c_set_gain_value(uint32_t gain) {
+  als21c_set_gain_value(&als21c_dev, gain);
+}
+
+uint32_t als21c_get_gain_value() {
+  return als21c_get_gain_value(&als21c_dev);
+}
+
+void als21c_set_integration(als21c_int_time_t itime, uint8_t icount) {
+  als21c_set_integration(&als21c_dev, itime, icount);
+}
+
+void als21c_set_integration_time(uint32_t count) {
+  als21c_set_integration_time(&als21c_dev, count);
+}
+
+uint32_t als21c_get_integration_time() {
+  return als21c_get_integration_time(&als21c_dev);
+}
+
+void als21c_set_integration_time_millisec(uint32_t millisec) {
+  als21c_set_integration_time_millisec(&als21c_dev, millisec);
+}
+
+uint32_t als21c_get_integration_time_millisec() {
+  return als21c_get_integration_time_millisec(&als21c_dev);
+}
+
+void als21c_set_wait(als21c_wait_time_t unit, uint8_t count) {
+  als21c_set_wait(&als21c_dev, unit, count);
+}
+
+void als21c_set_wait_time_millisec(uint16_t millisec) {
+  als21c_set_wait_time_millisec(&als21c_dev, millisec);
+}
+
+uint32_t als21c_get_wait_time_millisec() {
+  return als21c_get_wait_time_millisec(&als21c_dev);
+}
+
+uint32_t als21c_get_delay_millisec() {
+  return als21c_get_delay_millisec(&als21c_dev);
+}
+
+int32_t als21c_get_max_count() {
+  return als21c_get_max_count(&als21c_dev);
+}
+
+void als21c_increase_gain() {
+  als21c_increase_gain(&als21c_dev);
+}
+
+void als21c_decrease_gain() {
+  als21c_decrease_gain(&als21c_dev);
+}
+
+int32_t als21c_count_to_lux(uint16_t count) {
+  return als21c_count_to_lux(&als21c_dev, count);
+}
+
+uint32_t als21c_lux_to_count(int32_t lux) {
+  return als21c_lux_to_count(&als21c_dev, lux);
+}
+
+int32_t als21c_read_als() {
+  return als21c_read_als(&als21c_dev);
+}
+
+int32_t als21c_read_lux() {
+  return als21c_read_lux(&als21c_dev);
+}
+
+uint32_t als21c_micros() {
+  return als21c_micros(&als21c_dev);
+}
+
+uint32_t als21c_start(bool once) {
+  return als21c_start(&als21c_dev, once);
+}
+
+int32_t als21c_poll(uint32_t now_us) {
+  return als21c_poll(&als21c_dev, now_us);
+}
+
+uint32_t als21c_get_deadline() {
+  return als21c_get_deadline(&als21c_dev);
+}
+
+/* the default sensor streams with a tracker of its own */
+uint32_t als21c_stream_start() {
+  static als21c_track_t track;
+  if (als21c_dev.track == NULL) als21c_set_track(&als21c_dev, &track);
+  return als21c_stream_start(&als21c_dev);
+}
+
+uint32_t als21c_get_period() {
+  return als21c_get_period(&als21c_dev);
+}
+
+void als21c_set_auto_lux(bool onoff) {
+  als21c_set_auto_lux(&als21c_dev, onoff);
+}
+
+void als21c_set_auto_lux_mode(als21c_auto_lux_t mode) {
+  als21c_set_auto_lux_mode(&als21c_dev, mode);
+}
+
+uint8_t als21c_get_range() {
+  return als21c_get_range(&als21c_dev);
+}
+
+void als21c_set_range(uint8_t range) {
+  als21c_set_range(&als21c_dev, range);
+}
+
+void als21c_enable_interrupt(bool onoff) {
+  als21c_enable_interrupt(&als21c_dev, onoff);
+}
+
+void als21c_enable_als_sync(bool onoff) {
+  als21c_enable_als_sync(&als21c_dev, onoff);
+}
+
+bool als21c_interrupt_status() {
+  return als21c_interrupt_status(&als21c_dev);
+}
+
+void als21c_clear_interrupt() {
+  als21c_clear_interrupt(&als21c_dev);
+}
+
+void als21c_set_persistence(uint8_t pers) {
+  als21c_set_persistence(&als21c_dev, pers);
+}
+
 void als21c_set_low_threshold(uint16_t value) {
-  als21c_i2c_write16(ALS21C_REG_ALS_THRES_L, value);
+  als21c_set_low_threshold(&als21c_dev, value);
 }
 
-/*!
- * @brief  set upper threshold for ALS count to trigger an interrupt
- * @param  value
- */
 void als21c_set_high_threshold(uint16_t value) {
-  als21c_i2c_write16(ALS21C_REG_ALS_THRES_H, value);
+  als21c_set_high_threshold(&als21c_dev, value);
+}
+
+void als21c_set_thresholds(uint16_t low, uint16_t high) {
+  als21c_set_thresholds(&als21c_dev, low, high);
 }
 
-/*!
- * @brief  get ALS product id
- * @return product id
- */
 uint16_t als21c_get_product_id() {
-  return als21c_i2c_read16(ALS21C_REG_PROD_ID);
+  return als21c_get_product_id(&als21c_dev);
+}
+
+void als21c_defer_writes() {
+  als21c_defer_writes(&als21c_dev);
+}
+
+void als21c_commit() {
+  als21c_commit(&als21c_dev);
+}
+
+void als21c_dump_regs() {
+  als21c_dump_regs(&als21c_dev);
 }
 
-/* sysm_ctrl register */
 void als21c_set_reg_sysm_ctrl() {
-  uint8_t dta = als21c_data.swrst << 7 | als21c_data.en_wait << 6 | als21c_data.en_frst << 5 | als21c_data.en_once << 1 | als21c_data.en_als;
-  als21c_i2c_write8(ALS21C_REG_SYSM_CTRL, dta);
+  als21c_set_reg_sysm_ctrl(&als21c_dev);
 }
 
-/* int_ctrl register */
 void als21c_set_reg_int_ctrl() {
-  uint8_t dta = als21c_data.als_sync << 4 | als21c_data.en_aint;
-  als21c_i2c_write8(ALS21C_REG_INT_CTRL, dta);
+  als21c_set_reg_int_ctrl(&als21c_dev);
 }
 
-/* set interrupt flag register */
 void als21c_set_reg_int_flag() {
-  uint8_t dta = als21c_data.int_por << 7 | als21c_data.data_flag << 6 | als21c_data.int_als;
-  als21c_i2c_write8(ALS21C_REG_INT_FLAG, dta);
+  als21c_set_reg_int_flag(&als21c_dev);
 }
 
-/* get interrupt flag register */
 void als21c_get_reg_int_flag() {
-  uint8_t data = als21c_i2c_read8(ALS21C_REG_INT_FLAG);
-  als21c_data.int_por = (data >> 7) & 0x1;
-  als21c_data.data_flag = (data >> 6) & 0x1;
-  als21c_data.int_als = data & 0x1;
+  als21c_get_reg_int_flag(&als21c_dev);
 }
 
-/* wait_time register */
 void als21c_set_reg_wait_time() {
-  uint8_t dta = als21c_data.wtime_unit << 6 | als21c_data.wtime;
-  als21c_i2c_write8(ALS21C_REG_WAIT_TIME, dta);
+  als21c_set_reg_wait_time(&als21c_dev);
 }
 
-/* als_gain register */
 void als21c_set_reg_als_gain() {
-  uint8_t dta = als21c_data.pd_sel << 7 | als21c_data.pga_als;
-  als21c_i2c_write8(ALS21C_REG_ALS_GAIN, dta);
+  als21c_set_reg_als_gain(&als21c_dev);
 }
 
-/* als_time register */
 void als21c_set_reg_als_time() {
-  uint8_t dta = als21c_data.als_conv << 4 | als21c_data.int_time;
-  als21c_i2c_write8(ALS21C_REG_ALS_TIME, dta);
+  als21c_set_reg_als_time(&als21c_dev);
 }
 
-/* persistence register */
 void als21c_set_reg_persistence() {
-  uint8_t dta = als21c_data.int_src << 4 | als21c_data.prs_als;
-  als21c_i2c_write8(ALS21C_REG_PERSISTENCE, dta);
+  als21c_set_reg_persistence(&als21c_dev);
 }
 
-/* data status register */
 void als21c_get_reg_data_status() {
-  uint8_t data = als21c_i2c_read8(ALS21C_REG_DATA_STATUS);
-  als21c_data.data_ready = (data >> 7) & 0x1;
-  als21c_data.saturation_als = (data >> 1) & 0x1;
-  als21c_data.saturation_comp = data & 0x1;
+  als21c_get_reg_data_status(&als21c_dev);
 }
 
-#ifdef __cplusplus
-}; /* namespace als21c */
-#endif
+void als21c_i2c_write8(const uint8_t reg, const uint8_t data) {
+  als21c_i2c_write8(&als21c_dev, reg, data);
+}
+
+void als21c_i2c_write16(const uint8_t reg, const uint16_t data) {
+  als21c_i2c_write16(&als21c_dev, reg, data);
+}
+
+uint8_t als21c_i2c_read8(const uint8_t reg) {
+  return als21c_i2c_read8(&als21c_dev, reg);
+}
+
+uint16_t als21c_i2c_read16(const uint8_t reg) {
+  return als21c_i2c_read16(&als21c_dev, reg);
+}
+
+} /* namespace als21c */
@@ -12,10 +12,12 @@
 
 #ifdef __cplusplus
 
+#include <cstddef>
 #include <cstdint>
 
 namespace als21c {
 #else
+#include <stddef.h>
 #include <stdint.h>
 #include <stdbool.h>
 #endif
@@ -53,6 +55,12 @@ enum {
   ALS21C_REG_PROD_ID = 0xBC,
 };
 
+/* integration time unit, microseconds */
+#define ALS21C_INT_TIME_US 1171
+
+/* burst read of data status up to and including als data */
+#define ALS21C_BURST_LEN (ALS21C_REG_ALS_DATA + 2 - ALS21C_REG_DATA_STATUS)
+
 /*! PGA_ALS gain values */
 typedef enum {
   ALS21C_GAIN_1X = 0x01,
@@ -78,6 +86,603 @@ typedef enum {
   ALS21C_WAIT_TIME_8T = 0x03, /* 64 milliseconds */
 } als21c_wait_time_t;
 
+typedef struct {
+  /* sysm_ctrl register */
+  uint8_t swrst : 1;
+  uint8_t en_wait : 1;
+  uint8_t en_frst : 1;
+  uint8_t en_once : 1;
+  uint8_t en_als : 1;
+  /* int_ctrl register */
+  uint8_t als_sync : 1;
+  uint8_t en_aint : 1;
+  /* int_flag register */
+  uint8_t int_por : 1;
+  uint8_t data_flag : 1;
+  uint8_t int_als : 1;
+  /* wait_time register */
+  uint8_t wtime_unit : 2;
+  uint8_t wtime : 6;
+  /* als_gain register */
+  uint8_t pd_sel : 1;
+  uint8_t pga_als : 5;
+  /* als_time register */
+  uint8_t als_conv : 4;
+  uint8_t int_time : 2;
+  /* persistence register */
+  uint8_t int_src : 1;
+  uint8_t prs_als : 4;
+  /* data status register */
+  uint8_t data_ready : 1;
+  uint8_t saturation_als : 1;
+  uint8_t saturation_comp : 1;
+  /* als data register */
+  uint16_t als_data;
+
+  /* automatically adjust gain and integration time, als21c_auto_lux_t */
+  uint8_t auto_lux;
+} als21c_data_s;
+
+/*! automatic adjustment of gain and integration time */
+typedef enum {
+  ALS21C_AUTO_LUX_OFF = 0,
+  ALS21C_AUTO_LUX_STEP = 1,    /* one step per reading */
+  ALS21C_AUTO_LUX_PREDICT = 2, /* jump to best range in one reading */
+} als21c_auto_lux_t;
+
+/* ranges: combinations of gain and integration time, in order of sensitivity */
+#define ALS21C_RANGE_MAX 27
+
+/* default I2C address of TCA9548-style multiplexer */
+#define ALS21C_MUX_ADDR 0x70
+
+/* register shadow: registers 0x00..0x05 and persistence */
+#define ALS21C_SHADOW_PERSISTENCE 6
+#define ALS21C_SHADOW_LEN 7
+#define ALS21C_SHADOW_MASK 0x7b /* int_flag is not shadowed */
+
+/*! configuration a sample was measured with */
+typedef enum {
+  ALS21C_SAMPLE_NEW = 0,   /* current configuration */
+  ALS21C_SAMPLE_OLD = 1,   /* configuration before the last change */
+  ALS21C_SAMPLE_STALE = 2, /* unknown; discard */
+} als21c_sample_t;
+
+/* status of the last sample read, track->flags */
+#define ALS21C_FLAG_SATURATION 0x01 /* analog saturation */
+#define ALS21C_FLAG_OVERFLOW 0x02   /* counter overflow */
+#define ALS21C_FLAG_OLD 0x04        /* measured with the configuration before the last change */
+#define ALS21C_FLAG_RANGE 0x08      /* auto lux changed gain or integration time after this sample */
+
+/*! non-blocking measurement, see als21c_start() */
+typedef enum {
+  ALS21C_MEAS_IDLE = 0,       /* no measurement started */
+  ALS21C_MEAS_SINGLE = 1,     /* single measurement, en_once */
+  ALS21C_MEAS_CONTINUOUS = 2, /* continuous measurement, en_als */
+} als21c_meas_t;
+
+/* no multiplexer, or multiplexer channel unknown */
+#define ALS21C_MUX_NONE -1
+
+/*!
+   I2C bus. Shared by all sensors on the same bus.
+   handle: os-dependent bus handle, e.g. TwoWire *. NULL is the default bus.
+   mux_addr: I2C address of the multiplexer, if any.
+   mux_channel: multiplexer channel currently selected.
+*/
+typedef struct {
+  void *handle;
+  uint8_t mux_addr;
+  int8_t mux_channel;
+} als21c_bus_t;
+
+/*!
+   sample tracking, optional; attach to a sensor with als21c_set_track().
+   for streaming. without, continuous measurement reads one nominal period
+   after the previous deadline, and the sample is not described.
+   period_us, period_err: sensor period, and how far off it may be, microseconds.
+   period_min, period_max: the sensor period is within these, 1/64 microseconds.
+   last_us, last_n: last sample read, microseconds, and its number. samples are
+     numbered on the sensor clock, lost samples included.
+   edge_us: time a sample became ready, the last one found.
+   early_us: last read that found no sample ready, if early.
+   ref_lo_us, ref_hi_us, ref_n: sample ref_n became ready between these: the grid. if grid.
+   last_max: highest number the last sample read can have; last_n is the lowest.
+   measured: period known within 1/1024.
+   samples: samples read, since start or configuration change.
+   dropped, dropped_max: samples lost between two reads, at least and at most. if these differ,
+     the reads did not show whether a sample was lost, as when reads take most of a period.
+   gain, itime: gain and integration time the last sample read was measured with.
+   flags: status of the last sample read, ALS21C_FLAG_*.
+*/
+typedef struct {
+  uint32_t period_us;
+  uint32_t period_err;
+  uint32_t period_min;
+  uint32_t period_max;
+  uint32_t last_us;
+  uint32_t last_n;
+  uint32_t last_max;
+  uint32_t edge_us;
+  uint32_t early_us;
+  uint32_t ref_lo_us;
+  uint32_t ref_hi_us;
+  uint32_t ref_n;
+  uint32_t samples;
+  uint32_t dropped;
+  uint32_t dropped_max;
+  uint16_t gain;
+  uint16_t itime;
+  uint8_t flags;
+  bool early;
+  bool grid;
+  bool measured;
+} als21c_track_t;
+
+/*!
+   one ambient light sensor.
+   data: register shadow and auto-lux state.
+   bus: bus the sensor is on. NULL is the default bus.
+   addr: I2C address, normally ALS21C_I2C_ADDR.
+   mux_channel: multiplexer channel, ALS21C_MUX_NONE if not behind a multiplexer.
+   transactions: number of I2C transactions, including multiplexer switches.
+   errors: number of failed I2C transactions.
+   shadow: last value written to the configuration registers.
+   shadow_valid: bitmask, shadow value known.
+   shadow_dirty: bitmask, shadow value not yet written to the sensor.
+   shadow_defer: hold back writes until als21c_commit().
+   config_gen: incremented on every write of gain, integration time, wait time or enable.
+   config_pending: samples may still have been measured with the previous configuration.
+   config_gain, config_itime: gain and integration time written to the sensor.
+   config_old_gain, config_old_itime: before the last change. gain 0 if not known.
+   config_int_us, config_wait_us: integration and wait time written to the sensor.
+   config_old_us: samples read before this time are from the old configuration, microseconds.
+   config_ready_us: first sample with the current configuration ready, microseconds.
+   meas_state: non-blocking measurement, als21c_meas_t.
+   meas_deadline_us: next sample ready, microseconds.
+   track: sample tracking, NULL if none. see als21c_track_t.
+   scale_key: gain and integration time registers scale_mul and scale_shift were computed for.
+   scale_mul, scale_shift: 256 * count / (gain * itime) is count * scale_mul >> scale_shift.
+*/
+typedef struct {
+  als21c_data_s data;
+  als21c_bus_t *bus;
+  uint8_t addr;
+  int8_t mux_channel;
+  uint32_t transactions;
+  uint16_t errors;
+  uint8_t shadow[ALS21C_SHADOW_LEN];
+  uint8_t shadow_valid;
+  uint8_t shadow_dirty;
+  bool shadow_defer;
+  uint8_t config_gen;
+  bool config_pending;
+  uint16_t config_gain;
+  uint16_t config_itime;
+  uint16_t config_old_gain;
+  uint16_t config_old_itime;
+  uint32_t config_int_us;
+  uint32_t config_wait_us;
+  uint32_t config_old_us;
+  uint32_t config_ready_us;
+  uint8_t meas_state;
+  uint32_t meas_deadline_us;
+  als21c_track_t *track;
+  uint16_t scale_key;
+  uint8_t scale_shift;
+  uint32_t scale_mul;
+} als21c_dev_t;
+
+/* interrupt pipeline: queue lengths, powers of two */
+#define ALS21C_IRQ_EVENTS 8
+#define ALS21C_IRQ_READINGS 8
+
+/* interrupt pipeline: default threshold window around the last reading, percent */
+#define ALS21C_IRQ_HYST_PERCENT 12
+/* interrupt pipeline: smallest threshold window, counts */
+#define ALS21C_IRQ_WINDOW_MIN 10
+/* interrupt pipeline: largest persistence, after noise or flicker */
+#define ALS21C_IRQ_PERS_MAX 8
+/* interrupt pipeline: quiet spell after which persistence goes down, in persistence periods */
+#define ALS21C_IRQ_QUIET 16
+
+/*! interrupt pipeline: threshold window */
+typedef enum {
+  ALS21C_WINDOW_OPEN = 0,      /* no reading yet: every measurement interrupts */
+  ALS21C_WINDOW_LUX = 1,       /* window in lux around the last reading */
+  ALS21C_WINDOW_SATURATED = 2, /* interrupt when back in range */
+} als21c_window_t;
+
+/*! one sample, as delivered by the interrupt pipeline */
+typedef struct {
+  uint32_t t_us;      /* time of interrupt, microseconds */
+  int32_t lux;        /* lux, or negative error */
+  uint16_t count;     /* ALS count */
+  uint8_t config_gen; /* dev->config_gen of the sample */
+} als21c_reading_t;
+
+/*!
+   interrupt pipeline of one sensor.
+   the interrupt handler only queues a timestamp, lock-free, in event_us[].
+   als21c_irq_handle(), outside interrupt context, does the bus work and
+   queues readings in reading[], lock-free, for the consumer.
+   each queue has one producer and one consumer. head is only written by
+   the producer, tail only by the consumer.
+   event_overruns: interrupts lost, event queue full.
+   reading_overruns: readings lost, consumer too slow.
+   hyst_lux, hyst_percent: threshold window, at least this much above and below the last reading.
+   pers: persistence now. pers_min: persistence set by als21c_irq_enable().
+   window: als21c_window_t.
+   window_gen: dev->config_gen the thresholds were computed with.
+   centre_lux: last reading, centre of the window.
+   centre_us: time of last reading or persistence change.
+   prev_lux: reading before, -1 if none.
+*/
+typedef struct {
+  als21c_dev_t *dev;
+  uint8_t event_head;
+  uint8_t event_tail;
+  uint32_t event_us[ALS21C_IRQ_EVENTS];
+  uint8_t reading_head;
+  uint8_t reading_tail;
+  als21c_reading_t reading[ALS21C_IRQ_READINGS];
+  uint16_t event_overruns;
+  uint16_t reading_overruns;
+  uint32_t hyst_lux;
+  uint8_t hyst_percent;
+  uint8_t pers;
+  uint8_t pers_min;
+  uint8_t window;
+  uint8_t window_gen;
+  int32_t centre_lux;
+  uint32_t centre_us;
+  int32_t prev_lux;
+} als21c_irq_t;
+
+/*! one recorded sample, with the gain and integration time it was measured with */
+typedef struct {
+  uint16_t count; /* ALS count */
+  uint16_t gain;  /* gain, 1 to 512 */
+  uint16_t itime; /* integration time, units of 1.17 ms */
+} als21c_record_t;
+
+/* fleet: most sensors */
+#ifndef ALS21C_FLEET_MAX
+#define ALS21C_FLEET_MAX 32
+#endif
+
+/*!
+   fleet: many sensors, measuring at the same time, read in deadline order.
+   all sensors integrate at once; a refresh of the fleet takes about one
+   integration time plus one burst read per sensor.
+   dev: the sensors, sorted by bus and multiplexer channel.
+   once: single measurements, started again right after each read. else continuous.
+*/
+typedef struct {
+  als21c_dev_t *dev[ALS21C_FLEET_MAX];
+  uint8_t n;
+  bool once;
+} als21c_fleet_t;
+
+/*! latest reading of a sensor, with the configuration it was measured with */
+typedef struct {
+  uint32_t t_us;      /* time of read, micros() */
+  int32_t lux;        /* lux, or negative error */
+  uint16_t count;     /* ALS count */
+  uint16_t gain;      /* gain, 1 to 512 */
+  uint16_t itime;     /* integration time, units of 1.17 ms */
+  uint8_t config_gen; /* dev->config_gen after the read */
+  uint8_t flags;      /* ALS21C_FLAG_* */
+} als21c_snapshot_t;
+
+/*!
+   latest reading, shared by one sampling task and any number of readers.
+   one task owns the sensor and publishes; readers copy, without lock and
+   without bus access. two copies: a reader copies the one not being
+   written, and tries again only if a publish ended meanwhile.
+   seq: incremented before each copy is written. odd: copy 0 being written, readers take copy 1.
+   track: sample tracking of a sensor polled without, for gain, itime and flags. sampling task only.
+*/
+typedef struct {
+  uint32_t seq;
+  als21c_snapshot_t snapshot[2];
+  als21c_track_t track;
+} als21c_latest_t;
+
+/* filter: longest running median, samples */
+#ifndef ALS21C_MEDIAN_MAX
+#define ALS21C_MEDIAN_MAX 9
+#endif
+
+/*!
+   filter: exponential moving average, y += (x - y) / 2^shift, rounded.
+   acc: y in 48.16 fixed point; the step rounds to within 1/4, so y reaches x.
+   shift: 0 passes samples through.
+*/
+typedef struct {
+  int64_t acc;
+  uint8_t shift;
+  bool init;
+} als21c_ema_t;
+
+/*!
+   filter: running median of the last n samples.
+   ring: last n samples, oldest at ring[pos].
+   sorted: the same samples, sorted.
+   count: samples so far, up to n.
+   n: 1 passes samples through.
+*/
+typedef struct {
+  int32_t ring[ALS21C_MEDIAN_MAX];
+  int32_t sorted[ALS21C_MEDIAN_MAX];
+  uint8_t n;
+  uint8_t pos;
+  uint8_t count;
+} als21c_median_t;
+
+/*!
+   filter: n to 1 decimation, mean of n samples.
+   n: 1 passes samples through.
+*/
+typedef struct {
+  int64_t sum;
+  uint16_t n;
+  uint16_t count;
+} als21c_decimate_t;
+
+/*!
+   filter pipeline: running median, then moving average, then decimation.
+   integer math, fixed memory, constant work per sample.
+   errors: negative samples (sensor errors) skipped.
+*/
+typedef struct {
+  als21c_median_t median;
+  als21c_ema_t ema;
+  als21c_decimate_t decimate;
+  uint32_t errors;
+} als21c_filter_t;
+
+/*!
+   HDR: two configurations, measured in turn, merged.
+   gain, itime: gain and integration time of each configuration. 0 is the most sensitive.
+   lux, weight: last reading of each, and its weight in the merge. weight 0 if saturated.
+   phase: configuration measuring now.
+   have: bitmask, reading of configuration present.
+*/
+typedef struct {
+  als21c_dev_t *dev;
+  uint16_t gain[2];
+  uint16_t itime[2];
+  int32_t lux[2];
+  uint32_t weight[2];
+  uint8_t phase;
+  uint8_t have;
+} als21c_hdr_t;
+
+/* flicker analysis: Goertzel filters at 1, 2, ... times mains frequency */
+#ifndef ALS21C_FLICKER_BINS
+#define ALS21C_FLICKER_BINS 8
+#endif
+/* flicker analysis: longest window, samples */
+#define ALS21C_FLICKER_MAX_N 4096
+/* flicker analysis: below this percent flicker, in 0.01 %, no flicker */
+#define ALS21C_FLICKER_MIN_PERCENT 100
+
+/*! flicker analysis: kind of flicker */
+typedef enum {
+  ALS21C_FLICKER_NONE = 0,  /* percent flicker below ALS21C_FLICKER_MIN_PERCENT */
+  ALS21C_FLICKER_MAINS = 1, /* most of the modulation at mains harmonics, e.g. 100/120 Hz */
+  ALS21C_FLICKER_OTHER = 2, /* elsewhere: pwm dimming, or pwm above the sample rate, aliased */
+} als21c_flicker_kind_t;
+
+/*!
+   flicker analysis: result of one window.
+   mean: mean level.
+   percent: percent flicker, 100 * (max - min) / (max + min), in 0.01 %.
+   index: flicker index, area above the mean / total area, in 1/1000.
+   mains: part of the modulation power at mains harmonics, in 1/1000.
+   amplitude[i]: amplitude at (i + 1) * mains frequency. 0 at and above half the sample rate.
+   kind: als21c_flicker_kind_t.
+   errors: negative samples (sensor errors) skipped in the window.
+   levels are in the unit of the samples, lux or counts.
+*/
+typedef struct {
+  int32_t mean;
+  uint16_t percent;
+  uint16_t index;
+  uint16_t mains;
+  uint32_t amplitude[ALS21C_FLICKER_BINS];
+  uint8_t kind;
+  uint16_t errors;
+} als21c_flicker_result_t;
+
+/*!
+   flicker analysis: one window in progress.
+   s1, s2: Goertzel filter states.
+   ref: level subtracted from the samples; mean of the window before.
+   sum, sum_sq: of sample - ref, and its square.
+   above: of sample - ref, where positive.
+   valid: ref is the mean of earlier samples; otherwise the window only gives a mean.
+*/
+typedef struct {
+  int64_t s1[ALS21C_FLICKER_BINS];
+  int64_t s2[ALS21C_FLICKER_BINS];
+  int32_t ref;
+  int32_t min;
+  int32_t max;
+  int64_t sum;
+  uint64_t sum_sq;
+  uint64_t above;
+  uint16_t n;
+  uint16_t errors;
+  bool active;
+  bool valid;
+} als21c_flicker_window_t;
+
+/*!
+   flicker analysis of a stream of samples, see als21c_stream_start().
+   two windows of n samples, half a window apart: a result every n / 2 samples.
+   fixed memory, integer math, constant work per sample, no sample buffer.
+   n: window length, samples.
+   bins: filters below half the sample rate.
+   coef: Goertzel coefficients, 2 cos(2 pi f / fs), 2.14 fixed point.
+   mean: mean of the last window, if have_mean.
+   ready: result holds a new result.
+*/
+typedef struct {
+  uint16_t n;
+  uint16_t mains_hz;
+  uint8_t bins;
+  int32_t coef[ALS21C_FLICKER_BINS];
+  int32_t mean;
+  bool have_mean;
+  bool ready;
+  als21c_flicker_window_t window[2];
+  als21c_flicker_result_t result;
+} als21c_flicker_t;
+
+/* default sensor, used by the functions without device argument */
+extern als21c_dev_t als21c_dev;
+
+void als21c_bus_init(als21c_bus_t *bus, void *handle, uint8_t mux_addr);
+void als21c_init(als21c_dev_t *dev, als21c_bus_t *bus, int8_t mux_channel);
+
+void als21c_defer_writes(als21c_dev_t *dev);
+void als21c_commit(als21c_dev_t *dev);
+
+bool als21c_begin(als21c_dev_t *dev);
+void als21c_end(als21c_dev_t *dev);
+void als21c_reset(als21c_dev_t *dev);
+void als21c_enable(als21c_dev_t *dev, bool onoff);
+void als21c_enable_once(als21c_dev_t *dev, bool onoff);
+void als21c_set_gain(als21c_dev_t *dev, uint8_t pdsel, als21c_gain_t pdals);
+void als21c_set_gain_value(als21c_dev_t *dev, uint32_t gain);
+uint32_t als21c_get_gain_value(als21c_dev_t *dev);
+void als21c_set_integration(als21c_dev_t *dev, als21c_int_time_t itime, uint8_t icount);
+void als21c_set_integration_time(als21c_dev_t *dev, uint32_t count);
+uint32_t als21c_get_integration_time(als21c_dev_t *dev);
+void als21c_set_integration_time_millisec(als21c_dev_t *dev, uint32_t millisec);
+uint32_t als21c_get_integration_time_millisec(als21c_dev_t *dev);
+void als21c_set_wait(als21c_dev_t *dev, als21c_wait_time_t unit, uint8_t count);
+void als21c_set_wait_time_millisec(als21c_dev_t *dev, uint16_t millisec);
+uint32_t als21c_get_wait_time_millisec(als21c_dev_t *dev);
+uint32_t als21c_get_delay_millisec(als21c_dev_t *dev);
+int32_t als21c_get_max_count(als21c_dev_t *dev);
+void als21c_increase_gain(als21c_dev_t *dev);
+void als21c_decrease_gain(als21c_dev_t *dev);
+int32_t als21c_count_to_lux(als21c_dev_t *dev, uint16_t count);
+int32_t als21c_count_to_lux_config(uint16_t count, uint32_t gain, uint32_t itime);
+void als21c_scale_config(uint32_t gain, uint32_t itime, uint32_t *mul, uint8_t *shift);
+int32_t als21c_count_to_lux_scale(uint16_t count, uint32_t mul, uint8_t shift);
+void als21c_count_to_lux_array(const uint16_t *count, int32_t *lux, size_t n, uint32_t gain, uint32_t itime);
+void als21c_record_to_lux_array(const als21c_record_t *record, int32_t *lux, size_t n);
+uint32_t als21c_lux_to_count(als21c_dev_t *dev, int32_t lux);
+uint32_t als21c_lux_to_count_config(int32_t lux, uint32_t gain, uint32_t itime);
+void als21c_config_changed(als21c_dev_t *dev, uint32_t t0_us, uint32_t t1_us);
+void als21c_config_started(als21c_dev_t *dev, uint32_t t1_us);
+als21c_sample_t als21c_sample_config(als21c_dev_t *dev, uint32_t t0_us, uint32_t t1_us);
+int32_t als21c_read_als(als21c_dev_t *dev);
+int32_t als21c_read_lux(als21c_dev_t *dev);
+uint32_t als21c_micros(als21c_dev_t *dev);
+uint32_t als21c_start(als21c_dev_t *dev, bool once);
+int32_t als21c_poll(als21c_dev_t *dev, uint32_t now_us);
+uint32_t als21c_get_deadline(als21c_dev_t *dev);
+uint32_t als21c_stream_start(als21c_dev_t *dev);
+void als21c_set_track(als21c_dev_t *dev, als21c_track_t *track);
+uint32_t als21c_get_period(als21c_dev_t *dev);
+void als21c_meas_restart(als21c_dev_t *dev);
+void als21c_meas_early(als21c_dev_t *dev, uint32_t t0_us, uint32_t t1_us);
+void als21c_meas_sampled(als21c_dev_t *dev, uint32_t t0_us, uint32_t t1_us);
+void als21c_set_auto_lux(als21c_dev_t *dev, bool onoff);
+void als21c_set_auto_lux_mode(als21c_dev_t *dev, als21c_auto_lux_t mode);
+uint32_t als21c_range_gain(uint8_t range);
+uint32_t als21c_range_integration_time(uint8_t range);
+uint8_t als21c_get_range(als21c_dev_t *dev);
+void als21c_set_range(als21c_dev_t *dev, uint8_t range);
+int8_t als21c_auto_lux_range(als21c_dev_t *dev, uint16_t count, bool saturated);
+void als21c_enable_interrupt(als21c_dev_t *dev, bool onoff);
+void als21c_enable_als_sync(als21c_dev_t *dev, bool onoff);
+bool als21c_interrupt_status(als21c_dev_t *dev);
+void als21c_clear_interrupt(als21c_dev_t *dev);
+void als21c_set_persistence(als21c_dev_t *dev, uint8_t pers);
+void als21c_set_low_threshold(als21c_dev_t *dev, uint16_t value);
+void als21c_set_high_threshold(als21c_dev_t *dev, uint16_t value);
+void als21c_set_thresholds(als21c_dev_t *dev, uint16_t low, uint16_t high);
+uint16_t als21c_get_product_id(als21c_dev_t *dev);
+
+/* interrupt pipeline */
+void als21c_irq_init(als21c_irq_t *irq, als21c_dev_t *dev);
+void als21c_irq_enable(als21c_irq_t *irq, uint8_t pers);
+void als21c_irq_set_hysteresis(als21c_irq_t *irq, uint32_t lux, uint8_t percent);
+void als21c_irq_update(als21c_irq_t *irq, int32_t lux, uint32_t t_us);
+bool als21c_irq_relax(als21c_irq_t *irq, uint32_t now_us);
+void als21c_irq_window(als21c_irq_t *irq, uint16_t *low, uint16_t *high);
+void als21c_irq_isr(als21c_irq_t *irq);
+void als21c_irq_event(als21c_irq_t *irq, uint32_t t_us);
+bool als21c_irq_pending(als21c_irq_t *irq);
+bool als21c_irq_next_event(als21c_irq_t *irq, uint32_t *t_us);
+int als21c_irq_handle(als21c_irq_t *irq);
+void als21c_irq_push(als21c_irq_t *irq, const als21c_reading_t *reading);
+bool als21c_irq_read(als21c_irq_t *irq, als21c_reading_t *reading);
+
+/* filters */
+void als21c_ema_init(als21c_ema_t *ema, uint8_t shift);
+int32_t als21c_ema_update(als21c_ema_t *ema, int32_t value);
+void als21c_median_init(als21c_median_t *median, uint8_t n);
+int32_t als21c_median_update(als21c_median_t *median, int32_t value);
+void als21c_decimate_init(als21c_decimate_t *decimate, uint16_t n);
+bool als21c_decimate_update(als21c_decimate_t *decimate, int32_t value, int32_t *out);
+void als21c_filter_init(als21c_filter_t *filter, uint8_t median_n, uint8_t ema_shift, uint16_t decimate_n);
+bool als21c_filter_sample(als21c_filter_t *filter, int32_t value, int32_t *out);
+
+/* HDR */
+void als21c_hdr_init(als21c_hdr_t *hdr, als21c_dev_t *dev, uint32_t gain_high, uint32_t itime_high, uint32_t gain_low, uint32_t itime_low);
+uint32_t als21c_hdr_start(als21c_hdr_t *hdr);
+int32_t als21c_hdr_poll(als21c_hdr_t *hdr, uint32_t now_us);
+
+/* fleet */
+void als21c_fleet_init(als21c_fleet_t *fleet);
+bool als21c_fleet_add(als21c_fleet_t *fleet, als21c_dev_t *dev);
+uint32_t als21c_fleet_start(als21c_fleet_t *fleet, bool once);
+int32_t als21c_fleet_poll(als21c_fleet_t *fleet, uint32_t now_us, als21c_dev_t **dev);
+uint32_t als21c_fleet_deadline(als21c_fleet_t *fleet);
+void als21c_fleet_stop(als21c_fleet_t *fleet);
+
+/* latest reading */
+void als21c_latest_init(als21c_latest_t *latest);
+void als21c_latest_publish(als21c_latest_t *latest, const als21c_snapshot_t *snapshot);
+int32_t als21c_latest_poll(als21c_latest_t *latest, als21c_dev_t *dev, uint32_t now_us);
+bool als21c_latest_read(const als21c_latest_t *latest, als21c_snapshot_t *snapshot);
+int32_t als21c_latest_lux(const als21c_latest_t *latest);
+
+/* flicker analysis */
+void als21c_flicker_init(als21c_flicker_t *flicker, uint32_t period_us, uint16_t mains_hz, uint16_t n);
+bool als21c_flicker_sample(als21c_flicker_t *flicker, int32_t value);
+bool als21c_flicker_read(als21c_flicker_t *flicker, als21c_flicker_result_t *result);
+
+/* low-level register access */
+void als21c_set_reg_sysm_ctrl(als21c_dev_t *dev);
+void als21c_set_reg_int_ctrl(als21c_dev_t *dev);
+void als21c_set_reg_int_flag(als21c_dev_t *dev);
+void als21c_get_reg_int_flag(als21c_dev_t *dev);
+void als21c_set_reg_wait_time(als21c_dev_t *dev);
+void als21c_set_reg_als_gain(als21c_dev_t *dev);
+void als21c_set_reg_als_time(als21c_dev_t *dev);
+void als21c_set_reg_persistence(als21c_dev_t *dev);
+void als21c_get_reg_data_status(als21c_dev_t *dev);
+uint16_t als21c_get_reg_data(als21c_dev_t *dev);
+/* os-dependent */
+void als21c_dump_regs(als21c_dev_t *dev);
+/* I2C operations, with the transport of this build */
+void als21c_i2c_write8(als21c_dev_t *dev, const uint8_t reg, const uint8_t data);
+void als21c_i2c_write16(als21c_dev_t *dev, const uint8_t reg, const uint16_t data);
+uint8_t als21c_i2c_read8(als21c_dev_t *dev, const uint8_t reg);
+uint16_t als21c_i2c_read16(als21c_dev_t *dev, const uint8_t reg);
+bool als21c_i2c_read(als21c_dev_t *dev, const uint8_t reg, uint8_t *data, const uint8_t len);
+bool als21c_i2c_write(als21c_dev_t *dev, const uint8_t reg, const uint8_t *data, const uint8_t len);
+
+#ifdef __cplusplus
+/* default sensor */
 bool als21c_begin();
 void als21c_end();
 void als21c_reset();
@@ -98,9 +703,20 @@ uint32_t als21c_get_delay_millisec();
 int32_t als21c_get_max_count(void);
 void als21c_increase_gain(void);
 void als21c_decrease_gain(void);
+int32_t als21c_count_to_lux(uint16_t count);
+uint32_t als21c_lux_to_count(int32_t lux);
 int32_t als21c_read_als(void);
 int32_t als21c_read_lux(void);
+uint32_t als21c_micros(void);
+uint32_t als21c_start(bool once);
+int32_t als21c_poll(uint32_t now_us);
+uint32_t als21c_get_deadline(void);
+uint32_t als21c_stream_start(void);
+uint32_t als21c_get_period(void);
 void als21c_set_auto_lux(bool onoff);
+void als21c_set_auto_lux_mode(als21c_auto_lux_t mode);
+uint8_t als21c_get_range(void);
+void als21c_set_range(uint8_t range);
 void als21c_enable_interrupt(bool onoff);
 void als21c_enable_als_sync(bool onoff);
 bool als21c_interrupt_status(void);
@@ -108,9 +724,14 @@ void als21c_clear_interrupt(void);
 void als21c_set_persistence(uint8_t pers);
 void als21c_set_low_threshold(uint16_t value);
 void als21c_set_high_threshold(uint16_t value);
+void als21c_set_thresholds(uint16_t low, uint16_t high);
 uint16_t als21c_get_product_id(void);
+void als21c_defer_writes(void);
+void als21c_commit(void);
+void als21c_dump_regs(void);
 
-/* low-level register access */
+/* low-level register access to the default sensor, through als21c_data */
+extern als21c_data_s &als21c_data;
 void als21c_set_reg_sysm_ctrl(void);
 void als21c_set_reg_int_ctrl(void);
 void als21c_set_reg_int_flag(void);
@@ -120,49 +741,11 @@ void als21c_set_reg_als_gain(void);
 void als21c_set_reg_als_time(void);
 void als21c_set_reg_persistence(void);
 void als21c_get_reg_data_status(void);
-/* os-dependent */
-void als21c_dump_regs(void);
 void als21c_i2c_write8(const uint8_t reg, const uint8_t data);
 void als21c_i2c_write16(const uint8_t reg, const uint16_t data);
 uint8_t als21c_i2c_read8(const uint8_t reg);
 uint16_t als21c_i2c_read16(const uint8_t reg);
-
-typedef struct {
-  /* sysm_ctrl register */
-  uint8_t swrst : 1;
-  uint8_t en_wait : 1;
-  uint8_t en_frst : 1;
-  uint8_t en_once : 1;
-  uint8_t en_als : 1;
-  /* int_ctrl register */
-  uint8_t als_sync : 1;
-  uint8_t en_aint : 1;
-  /* int_flag register */
-  uint8_t int_por : 1;
-  uint8_t data_flag : 1;
-  uint8_t int_als : 1;
-  /* wait_time register */
-  uint8_t wtime_unit : 2;
-  uint8_t wtime : 6;
-  /* als_gain register */
-  uint8_t pd_sel : 1;
-  uint8_t pga_als : 5;
-  /* als_time register */
-  uint8_t als_conv : 4;
-  uint8_t int_time : 2;
-  /* persistence register */
-  uint8_t int_src : 1;
-  uint8_t prs_als : 4;
-  /* data status register */
-  uint8_t data_ready : 1;
-  uint8_t saturation_als : 1;
-  uint8_t saturation_comp : 1;
-
-  /* automatically adjust gain and integration time */
-  bool auto_lux;
-} als21c_data_s;
-
-extern als21c_data_s als21c_data;
+#endif
 
 #ifdef __cplusplus
 } /* namespace als21c */
@@ -0,0 +1,138 @@
+/*!
+ *
+ * 	I2C Driver for NEWOPT XYC_ALS21C ambient light sensor
+ *
+ * 	This is a library for the NEWOPT XYC_ALS21C breakout:
+ * 	http://oshwlab.com/koendv/xyc_als21c_k1
+ *
+ *      batch conversion of recorded counts to lux.
+ *      on x86 hosts built with -mavx2 or -msse4.1 the integer table path
+ *      is vectorized; the results are the same as als21c_count_to_lux_scale().
+ */
+
+#include <xyc_als21c_k1.h>
+#include <xyc_als21c_k1_table.h>
+
+#if defined(__AVX2__) || defined(__SSE4_1__)
+#include <immintrin.h>
+#endif
+
+namespace als21c {
+
+#if defined(__AVX2__) || defined(__SSE4_1__)
+
+/* lux table, 32-bit entries, for gathers */
+static const als21c_lux_table_t::wide_t lux_wide = als21c_lux_table_t::wide();
+
+static const unsigned step_shift = als21c_lux_table_t::step_shift;
+static const int32_t last_x = als21c_lux_table_t::length - 2;
+
+#endif
+
+#if defined(__AVX2__)
+
+/* 8 counts at a time. same steps as als21c_lux_table::lookup() */
+static size_t als21c_array_simd(const uint16_t *count, int32_t *lux, size_t n, uint32_t mul, uint8_t shift) {
+  const __m256i v_mul = _mm256_set1_epi32(mul);
+  const __m128i v_shift = _mm_cvtsi32_si128(shift);
+  const __m256i v_last = _mm256_set1_epi32(last_x);
+  const __m256i v_mask = _mm256_set1_epi32((1 << step_shift) - 1);
+  const __m256i v_step = _mm256_set1_epi32(1 << step_shift);
+  size_t i;
+
+  for (i = 0; i + 8 <= n; i += 8) {
+    __m256i c = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *)(count + i)));
+    __m256i q = _mm256_srl_epi32(_mm256_mullo_epi32(c, v_mul), v_shift);
+    __m256i x1 = _mm256_srli_epi32(q, step_shift);
+    __m256i delta_x = _mm256_and_si256(q, v_mask);
+    __m256i over = _mm256_cmpgt_epi32(x1, v_last);
+    x1 = _mm256_blendv_epi8(x1, v_last, over);
+    delta_x = _mm256_blendv_epi8(delta_x, v_step, over);
+    __m256i y1 = _mm256_i32gather_epi32(lux_wide.value, x1, 4);
+    __m256i y2 = _mm256_i32gather_epi32(lux_wide.value + 1, x1, 4);
+    __m256i dy = _mm256_srai_epi32(_mm256_mullo_epi32(_mm256_sub_epi32(y2, y1), delta_x), step_shift);
+    _mm256_storeu_si256((__m256i *)(lux + i), _mm256_add_epi32(y1, dy));
+  }
+  return i;
+}
+
+#elif defined(__SSE4_1__)
+
+/* 4 counts at a time. no gather in SSE; table loads are scalar */
+static size_t als21c_array_simd(const uint16_t *count, int32_t *lux, size_t n, uint32_t mul, uint8_t shift) {
+  const __m128i v_mul = _mm_set1_epi32(mul);
+  const __m128i v_shift = _mm_cvtsi32_si128(shift);
+  const __m128i v_last = _mm_set1_epi32(last_x);
+  const __m128i v_mask = _mm_set1_epi32((1 << step_shift) - 1);
+  const __m128i v_step = _mm_set1_epi32(1 << step_shift);
+  const int32_t *value = lux_wide.value;
+  size_t i;
+
+  for (i = 0; i + 4 <= n; i += 4) {
+    __m128i c = _mm_cvtepu16_epi32(_mm_loadl_epi64((const __m128i *)(count + i)));
+    __m128i q = _mm_srl_epi32(_mm_mullo_epi32(c, v_mul), v_shift);
+    __m128i x1 = _mm_srli_epi32(q, step_shift);
+    __m128i delta_x = _mm_and_si128(q, v_mask);
+    __m128i over = _mm_cmpgt_epi32(x1, v_last);
+    x1 = _mm_blendv_epi8(x1, v_last, over);
+    delta_x = _mm_blendv_epi8(delta_x, v_step, over);
+    int32_t i0 = _mm_cvtsi128_si32(x1), i1 = _mm_extract_epi32(x1, 1);
+    int32_t i2 = _mm_extract_epi32(x1, 2), i3 = _mm_extract_epi32(x1, 3);
+    __m128i y1 = _mm_setr_epi32(value[i0], value[i1], value[i2], value[i3]);
+    __m128i y2 = _mm_setr_epi32(value[i0 + 1], value[i1 + 1], value[i2 + 1], value[i3 + 1]);
+    __m128i dy = _mm_srai_epi32(_mm_mullo_epi32(_mm_sub_epi32(y2, y1), delta_x), step_shift);
+    _mm_storeu_si128((__m128i *)(lux + i), _mm_add_epi32(y1, dy));
+  }
+  return i;
+}
+
+#else
+
+static size_t als21c_array_simd(const uint16_t *, int32_t *, size_t, uint32_t, uint8_t) {
+  return 0;
+}
+
+#endif
+
+/*!
+ * @brief  convert counts to lux, all measured with the same gain and integration time
+ * @param  count
+ * @param  lux
+ *         n results
+ * @param  n
+ * @param  gain
+ * @param  itime
+ *         integration time, in units of 1.17 ms
+ */
+void als21c_count_to_lux_array(const uint16_t *count, int32_t *lux, size_t n, uint32_t gain, uint32_t itime) {
+  uint32_t mul;
+  uint8_t shift;
+  size_t i;
+  als21c_scale_config(gain, itime, &mul, &shift);
+  i = als21c_array_simd(count, lux, n, mul, shift);
+  for (; i < n; i++)
+    lux[i] = als21c_count_to_lux_scale(count[i], mul, shift);
+}
+
+/*!
+ * @brief  convert recorded samples to lux, each with its own gain and integration time
+ * @param  record
+ * @param  lux
+ *         n results
+ * @param  n
+ * records are converted in runs of the same gain and integration time
+ */
+void als21c_record_to_lux_array(const als21c_record_t *record, int32_t *lux, size_t n) {
+  uint16_t count[64];
+  size_t i = 0, len;
+  while (i < n) {
+    uint16_t gain = record[i].gain;
+    uint16_t itime = record[i].itime;
+    for (len = 0; len < 64 && i + len < n && record[i + len].gain == gain && record[i + len].itime == itime; len++)
+      count[len] = record[i + len].count;
+    als21c_count_to_lux_array(count, lux + i, len, gain, itime);
+    i += len;
+  }
+}
+
+} /* namespace als21c */
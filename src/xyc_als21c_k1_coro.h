@@ -0,0 +1,467 @@
+/*!
+ *
+ * 	I2C Driver for NEWOPT XYC_ALS21C ambient light sensor
+ *
+ * 	This is a library for the NEWOPT XYC_ALS21C breakout:
+ * 	http://oshwlab.com/koendv/xyc_als21c_k1
+ *
+ *      C++20 coroutines: lux = co_await sensor.read_lux(). the coroutine
+ *      sleeps until the sample is ready, or until the INT line fires, then
+ *      reads it in one burst. one thread, one event loop, many sensors.
+ *      header only; compile with -std=c++20.
+ */
+
+#ifndef _XYC_ALS21C_K1_CORO_H
+#define _XYC_ALS21C_K1_CORO_H
+
+#if __cplusplus < 202002L
+#error "xyc_als21c_k1_coro.h needs C++20"
+#endif
+
+#include <xyc_als21c_k1.h>
+#include <algorithm>
+#include <coroutine>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#ifdef ALS21C_SIM
+#include <xyc_als21c_k1_sim.h>
+#endif
+#if defined(__linux__) && !defined(ARDUINO)
+#include <ctime>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+#endif
+
+namespace als21c {
+
+template<class T> class als21c_task;
+
+/* coroutine done: go on with the coroutine that awaited it, if any */
+struct als21c_task_final {
+  bool await_ready() noexcept { return false; }
+  template<class P> std::coroutine_handle<> await_suspend(std::coroutine_handle<P> h) noexcept {
+    std::coroutine_handle<> next = h.promise().continuation;
+    return next ? next : std::noop_coroutine();
+  }
+  void await_resume() noexcept {}
+};
+
+/* no exceptions in this library */
+struct als21c_promise_base {
+  std::coroutine_handle<> continuation;
+  std::suspend_always initial_suspend() noexcept { return {}; }
+  als21c_task_final final_suspend() noexcept { return {}; }
+  void unhandled_exception() noexcept { std::terminate(); }
+};
+
+template<class T> struct als21c_promise : als21c_promise_base {
+  T value;
+  als21c_task<T> get_return_object() noexcept;
+  void return_value(T v) noexcept { value = v; }
+};
+
+template<> struct als21c_promise<void> : als21c_promise_base {
+  als21c_task<void> get_return_object() noexcept;
+  void return_void() noexcept {}
+};
+
+/*!
+   coroutine returning T. starts when awaited, or when given to spawn() of an event loop.
+   owns the coroutine frame.
+*/
+template<class T> class als21c_task {
+public:
+  typedef als21c_promise<T> promise_type;
+
+  explicit als21c_task(std::coroutine_handle<promise_type> h) : h(h) {}
+  als21c_task(als21c_task &&other) noexcept : h(std::exchange(other.h, nullptr)) {}
+  als21c_task(const als21c_task &) = delete;
+  als21c_task &operator=(const als21c_task &) = delete;
+  ~als21c_task() {
+    if (h) h.destroy();
+  }
+
+  bool done() const { return !h || h.done(); }
+  void start() { h.resume(); }
+
+  bool await_ready() const noexcept { return false; }
+  std::coroutine_handle<> await_suspend(std::coroutine_handle<> caller) noexcept {
+    h.promise().continuation = caller;
+    return h;
+  }
+  T await_resume() noexcept {
+    if constexpr (!std::is_void_v<T>) return h.promise().value;
+  }
+
+private:
+  std::coroutine_handle<promise_type> h;
+};
+
+template<class T> als21c_task<T> als21c_promise<T>::get_return_object() noexcept {
+  return als21c_task<T>(std::coroutine_handle<als21c_promise<T>>::from_promise(*this));
+}
+
+inline als21c_task<void> als21c_promise<void>::get_return_object() noexcept {
+  return als21c_task<void>(std::coroutine_handle<als21c_promise<void>>::from_promise(*this));
+}
+
+/*!
+   timers of an event loop, earliest first; same time in order of arrival.
+   fd: timeout of a wait for an interrupt, -1 for a plain sleep.
+*/
+class als21c_timers {
+protected:
+  struct timer_entry {
+    uint64_t t_us;
+    uint64_t id;
+    std::coroutine_handle<> h;
+    int fd;
+    bool operator>(const timer_entry &other) const {
+      return t_us != other.t_us ? t_us > other.t_us : id > other.id;
+    }
+  };
+  std::vector<timer_entry> timers;
+  uint64_t next_id = 0;
+
+  uint64_t add_timer(uint64_t t_us, std::coroutine_handle<> h, int fd) {
+    timers.push_back(timer_entry{ t_us, next_id, h, fd });
+    std::push_heap(timers.begin(), timers.end(), std::greater<timer_entry>());
+    return next_id++;
+  }
+
+  timer_entry pop_timer() {
+    std::pop_heap(timers.begin(), timers.end(), std::greater<timer_entry>());
+    timer_entry t = timers.back();
+    timers.pop_back();
+    return t;
+  }
+
+  /* 32-bit micros() to 64-bit time, near now */
+  static uint64_t widen(uint64_t now_us, uint32_t t_us) {
+    int32_t d = (int32_t)(t_us - (uint32_t)now_us);
+    return d > 0 ? now_us + d : now_us;
+  }
+};
+
+#if defined(__linux__) && !defined(ARDUINO)
+
+/*!
+   linux event loop. epoll, with one timerfd for all timers.
+   interrupts are file descriptors that become readable, e.g. a gpio line
+   from als21c_linux_gpio_open(). the clock is CLOCK_MONOTONIC, as micros()
+   of the linux transport.
+*/
+class als21c_epoll_loop : public als21c_timers {
+public:
+  typedef int irq_t;
+  static constexpr int no_irq = -1;
+
+  als21c_epoll_loop() {
+    struct epoll_event ev = {};
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    ev.events = EPOLLIN;
+    ev.data.fd = timer_fd;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, timer_fd, &ev);
+  }
+  ~als21c_epoll_loop() {
+    tasks.clear();
+    close(timer_fd);
+    close(epoll_fd);
+  }
+
+  static uint64_t now_us() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+  }
+  uint32_t micros() const { return (uint32_t)now_us(); }
+
+  struct sleep_awaiter {
+    als21c_epoll_loop *loop;
+    uint32_t t_us;
+    bool await_ready() const { return (int32_t)(t_us - loop->micros()) <= 0; }
+    void await_suspend(std::coroutine_handle<> h) { loop->add_timer(widen(now_us(), t_us), h, -1); }
+    void await_resume() const {}
+  };
+
+  struct irq_awaiter {
+    als21c_epoll_loop *loop;
+    int fd;
+    uint32_t timeout_us;
+    bool fired;
+    bool await_ready() const { return false; }
+    void await_suspend(std::coroutine_handle<> h) { loop->add_wait(fd, timeout_us, h, &fired); }
+    bool await_resume() const {
+      char buf[256];
+      /* nonblocking fd: take the events, e.g. struct gpio_v2_line_event */
+      if (fired)
+        while (read(fd, buf, sizeof(buf)) > 0) continue;
+      return fired;
+    }
+  };
+
+  /*! co_await: until time t_us of micros() */
+  sleep_awaiter sleep_until(uint32_t t_us) { return sleep_awaiter{ this, t_us }; }
+
+  /*! co_await: until fd is readable, true; or until time timeout_us, false */
+  irq_awaiter wait_irq(int fd, uint32_t timeout_us) { return irq_awaiter{ this, fd, timeout_us, false }; }
+
+  /*! run a coroutine. the loop keeps it until run() returns */
+  void spawn(als21c_task<void> &&task) {
+    tasks.push_back(std::move(task));
+    tasks.back().start();
+  }
+
+  /*! run until no coroutine waits */
+  void run() {
+    struct epoll_event ev[64];
+    while (!timers.empty()) {
+      if (timers.front().t_us <= now_us()) {
+        timer_entry t = pop_timer();
+        if (t.fd >= 0) {
+          irq_wait &w = waits[t.fd];
+          /* the wait ended before its timeout */
+          if (!w.h || w.id != t.id) continue;
+          w.h = nullptr;
+          *w.fired = false;
+        }
+        t.h.resume();
+        continue;
+      }
+      arm(timers.front().t_us);
+      int n = epoll_wait(epoll_fd, ev, 64, -1);
+      for (int i = 0; i < n; i++) {
+        int fd = ev[i].data.fd;
+        if (fd == timer_fd) {
+          uint64_t expirations;
+          if (read(timer_fd, &expirations, sizeof(expirations)) > 0) armed_us = 0;
+          continue;
+        }
+        if ((size_t)fd >= waits.size() || !waits[fd].h) continue;
+        std::coroutine_handle<> h = waits[fd].h;
+        waits[fd].h = nullptr;
+        *waits[fd].fired = true;
+        h.resume();
+      }
+    }
+    tasks.clear();
+  }
+
+private:
+  /* wait for an interrupt fd. registered: added to epoll; one shot, armed again for each wait */
+  struct irq_wait {
+    std::coroutine_handle<> h;
+    uint64_t id;
+    bool *fired;
+    bool registered;
+  };
+  int epoll_fd;
+  int timer_fd;
+  uint64_t armed_us = 0;
+  std::vector<irq_wait> waits;
+  std::vector<als21c_task<void>> tasks;
+
+  void add_wait(int fd, uint32_t timeout_us, std::coroutine_handle<> h, bool *fired) {
+    struct epoll_event ev = {};
+    if ((size_t)fd >= waits.size()) waits.resize(fd + 1, irq_wait{ nullptr, 0, nullptr, false });
+    irq_wait &w = waits[fd];
+    ev.events = EPOLLIN | EPOLLONESHOT;
+    ev.data.fd = fd;
+    if (epoll_ctl(epoll_fd, w.registered ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, fd, &ev) == 0) w.registered = true;
+    w.h = h;
+    w.fired = fired;
+    w.id = add_timer(widen(now_us(), timeout_us), h, fd);
+  }
+
+  /* timerfd to the earliest timer */
+  void arm(uint64_t t_us) {
+    struct itimerspec its = {};
+    if (t_us == armed_us) return;
+    its.it_value.tv_sec = t_us / 1000000;
+    its.it_value.tv_nsec = (t_us % 1000000) * 1000;
+    timerfd_settime(timer_fd, TFD_TIMER_ABSTIME, &its, NULL);
+    armed_us = t_us;
+  }
+};
+
+#endif
+
+#ifdef ALS21C_SIM
+
+/*!
+   event loop on the simulated clock, for tests. the clock jumps to the next
+   timer, or to the next event of a simulated sensor an interrupt wait is on.
+   interrupts are the INT lines of simulated sensors.
+   clock: the bus whose clock all buses share, see als21c_sim_bus::share_clock().
+*/
+class als21c_sim_loop : public als21c_timers {
+public:
+  typedef als21c_sim *irq_t;
+  static constexpr als21c_sim *no_irq = nullptr;
+
+  explicit als21c_sim_loop(als21c_sim_bus *clock) : clock(clock) {}
+  ~als21c_sim_loop() { tasks.clear(); }
+
+  uint32_t micros() const { return (uint32_t)clock->now(); }
+
+  struct sleep_awaiter {
+    als21c_sim_loop *loop;
+    uint32_t t_us;
+    bool await_ready() const { return (int32_t)(t_us - loop->micros()) <= 0; }
+    void await_suspend(std::coroutine_handle<> h) { loop->add_timer(widen(loop->clock->now(), t_us), h, -1); }
+    void await_resume() const {}
+  };
+
+  struct irq_awaiter {
+    als21c_sim_loop *loop;
+    als21c_sim *sensor;
+    uint32_t timeout_us;
+    bool fired;
+    bool await_ready() const { return false; }
+    void await_suspend(std::coroutine_handle<> h) {
+      loop->waits.push_back(irq_wait{ sensor, widen(loop->clock->now(), timeout_us), h, &fired });
+    }
+    bool await_resume() const { return fired; }
+  };
+
+  /*! co_await: until time t_us of micros() */
+  sleep_awaiter sleep_until(uint32_t t_us) { return sleep_awaiter{ this, t_us }; }
+
+  /*! co_await: until the INT line of sensor is asserted, true; or until time timeout_us, false */
+  irq_awaiter wait_irq(als21c_sim *sensor, uint32_t timeout_us) { return irq_awaiter{ this, sensor, timeout_us, false }; }
+
+  /*! run a coroutine. the loop keeps it until run() returns */
+  void spawn(als21c_task<void> &&task) {
+    tasks.push_back(std::move(task));
+    tasks.back().start();
+  }
+
+  /*! run until no coroutine waits */
+  void run() {
+    while (!timers.empty() || !waits.empty()) {
+      uint64_t now = clock->now();
+      uint64_t next = UINT64_MAX;
+      if (resume_wait(now, &next)) continue;
+      if (!timers.empty()) {
+        if (timers.front().t_us <= now) {
+          pop_timer().h.resume();
+          continue;
+        }
+        next = std::min(next, timers.front().t_us);
+      }
+      clock->advance_to(next);
+    }
+    tasks.clear();
+  }
+
+private:
+  struct irq_wait {
+    als21c_sim *sensor;
+    uint64_t t_us;
+    std::coroutine_handle<> h;
+    bool *fired;
+  };
+  als21c_sim_bus *clock;
+  std::vector<irq_wait> waits;
+  std::vector<als21c_task<void>> tasks;
+
+  /* resume one wait whose INT line is asserted or whose timeout passed; else the time of the next */
+  bool resume_wait(uint64_t now, uint64_t *next) {
+    for (size_t i = 0; i < waits.size(); i++) {
+      irq_wait w = waits[i];
+      w.sensor->advance(now);
+      if (w.sensor->interrupt() || w.t_us <= now) {
+        *w.fired = w.sensor->interrupt();
+        waits[i] = waits.back();
+        waits.pop_back();
+        w.h.resume();
+        return true;
+      }
+      *next = std::min(*next, w.t_us);
+      if (w.sensor->next_event() > now) *next = std::min(*next, w.sensor->next_event());
+    }
+    return false;
+  }
+};
+
+#endif
+
+/*!
+   sensor for coroutines, on event loop Loop: als21c_epoll_loop, als21c_sim_loop,
+   or a loop of your own with the same micros(), sleep_until() and wait_irq().
+   dev: initialized with als21c_init() and als21c_begin(). only this object touches it.
+   irq: INT line, Loop::no_irq if not connected. with INT, every measurement interrupts.
+   if dev has no tracker, the object attaches its own, track.
+*/
+template<class Loop> class als21c_async {
+public:
+  als21c_async(Loop &loop, als21c_dev_t *dev, typename Loop::irq_t irq = Loop::no_irq) : loop(loop), dev(dev), irq(irq) {
+    if (!dev->track) als21c_set_track(dev, &track);
+  }
+  ~als21c_async() {
+    if (dev->track == &track) dev->track = NULL;
+  }
+  als21c_async(const als21c_async &) = delete;
+  als21c_async &operator=(const als21c_async &) = delete;
+
+  /*!
+   * @brief  start continuous measurement. read_lux() starts it if needed.
+   */
+  void start() {
+    if (irq != Loop::no_irq) {
+      als21c_set_persistence(dev, 0);
+      als21c_clear_interrupt(dev);
+      als21c_enable_interrupt(dev, true);
+    }
+    als21c_start(dev, false);
+  }
+
+  /*!
+   * @brief  stop measurement
+   */
+  void stop() {
+    if (irq != Loop::no_irq) als21c_enable_interrupt(dev, false);
+    als21c_enable(dev, false);
+  }
+
+  /*!
+   * @brief  co_await: next reading. suspends until the sample is ready: the
+   *         deadline of als21c_poll(), or the INT line. then one burst read,
+   *         conversion and auto lux, as als21c_read_lux().
+   *         with INT, INT_FLAG is cleared after the read. without an edge by
+   *         half a period after the deadline, reads anyway.
+   * @return lux, or negative error
+   */
+  als21c_task<int32_t> read_lux() {
+    if (dev->meas_state == ALS21C_MEAS_IDLE) start();
+    for (;;) {
+      int32_t lux;
+      if (irq != Loop::no_irq) {
+        uint32_t period_us = als21c_get_period(dev);
+        bool fired = co_await loop.wait_irq(irq, als21c_get_deadline(dev) + period_us / 2);
+        /* the INT line says the sample is ready, deadline or not */
+        lux = als21c_poll(dev, fired ? als21c_get_deadline(dev) : loop.micros());
+        if (fired || lux != ALS21C_ERR_NOT_READY) als21c_clear_interrupt(dev);
+      } else {
+        co_await loop.sleep_until(als21c_get_deadline(dev));
+        lux = als21c_poll(dev, loop.micros());
+      }
+      if (lux != ALS21C_ERR_NOT_READY) co_return lux;
+    }
+  }
+
+  Loop &loop;
+  als21c_dev_t *dev;
+  typename Loop::irq_t irq;
+  als21c_track_t track;
+};
+
+} /* namespace als21c */
+
+#endif
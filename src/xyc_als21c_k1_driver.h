@@ -0,0 +1,837 @@
+/*!
+ *
+ * 	I2C Driver for NEWOPT XYC_ALS21C ambient light sensor
+ *
+ * 	This is a library for the NEWOPT XYC_ALS21C breakout:
+ * 	http://oshwlab.com/koendv/xyc_als21c_k1
+ *
+ *      driver core, as template over the I2C transport
+ */
+
+#ifndef _XYC_ALS21C_K1_DRIVER_H
+#define _XYC_ALS21C_K1_DRIVER_H
+
+#include <xyc_als21c_k1.h>
+#include <cstring>
+
+namespace als21c {
+
+/*!
+   driver core, as template over the I2C transport.
+
+   A transport is a class with three static functions and a constant:
+     bool read(als21c_dev_t *dev, uint8_t reg, uint8_t *data, uint8_t len);
+     bool write(als21c_dev_t *dev, uint8_t reg, const uint8_t *data, uint8_t len);
+   a register read or write with auto-increment, including multiplexer
+   channel selection. They return false if the sensor does not answer.
+     uint32_t micros(als21c_dev_t *dev);
+   the clock of the deadlines, microseconds, wrapping around; per device,
+   as the simulator has a clock per bus.
+     static const uint32_t clock_res_us;
+   resolution of micros(), plus scheduling delay. Time stamps of a read are
+   widened by this, and deadlines are this much later.
+
+   Transports: als21c_wire_transport (Arduino), als21c_linux_transport (linux i2c-dev),
+   als21c_sim_transport (simulator), als21c_rtthread_transport (rt-thread).
+
+   Register packing and bus access inline into the caller, without function pointers.
+   The als21c_* functions are als21c_driver<als21c_transport>, with
+   als21c_transport selected in xyc_als21c_k1_transport.h.
+*/
+template <class Transport>
+class als21c_driver {
+public:
+  /*!
+   * @brief  initializes ambient light sensor
+   */
+  static bool begin(als21c_dev_t *dev) {
+    if (get_product_id(dev) != ALS21C_PRODUCT_ID)
+      return false;
+    /* reset */
+    reset(dev);
+    return true;
+  }
+
+  /*!
+   * @brief  stop ambient light sensor measurement and interrupts
+   */
+  static void end(als21c_dev_t *dev) {
+    write8(dev, ALS21C_REG_SYSM_CTRL, 0x0); /* disable als */
+    write8(dev, ALS21C_REG_INT_CTRL, 0x0);  /* disable interrupts */
+    dev->shadow[ALS21C_REG_SYSM_CTRL] = 0x0;
+    dev->shadow[ALS21C_REG_INT_CTRL] = 0x0;
+    dev->shadow_valid |= 1 << ALS21C_REG_SYSM_CTRL | 1 << ALS21C_REG_INT_CTRL;
+    dev->shadow_dirty &= ~(1 << ALS21C_REG_SYSM_CTRL | 1 << ALS21C_REG_INT_CTRL);
+    /* register fields as written, and no measurement to poll */
+    dev->data.en_wait = 0x0;
+    dev->data.en_frst = 0x0;
+    dev->data.en_once = 0x0;
+    dev->data.en_als = 0x0;
+    dev->data.als_sync = 0x0;
+    dev->data.en_aint = 0x0;
+    dev->meas_state = ALS21C_MEAS_IDLE;
+  }
+
+  /*!
+   * @brief  reset ALS sensor. writes held back by defer_writes() are dropped.
+   */
+  static void reset(als21c_dev_t *dev) {
+    /* clear */
+    memset(&dev->data, 0, sizeof(dev->data));
+    /* reset, now, also between defer_writes() and commit(); pending writes are dropped */
+    write8(dev, ALS21C_REG_SYSM_CTRL, 1 << 7);
+    dev->shadow_defer = false;
+    /* default values after reset */
+    dev->data.en_aint = 0x1;
+    dev->data.pga_als = 0x1;
+    dev->data.int_time = 0x3;
+    dev->data.prs_als = 0x1;
+    /* shadow: register values after reset */
+    static const uint8_t shadow_reset[ALS21C_SHADOW_LEN] = {
+      0x00, /* sysm_ctrl */
+      0x01, /* int_ctrl: en_aint */
+      0x00, /* int_flag, not shadowed */
+      0x00, /* wait_time */
+      0x01, /* als_gain: 1x */
+      0x03, /* als_time: 64T */
+      0x01, /* persistence */
+    };
+    memcpy(dev->shadow, shadow_reset, sizeof(dev->shadow));
+    dev->shadow_valid = ALS21C_SHADOW_MASK;
+    dev->shadow_dirty = 0;
+  }
+
+  /*!
+   * @brief  switch ambient light sensor on/off
+   * @param  onoff
+   */
+  static void enable(als21c_dev_t *dev, bool onoff) {
+    dev->data.en_als = onoff ? 0x1 : 0x0;
+    if (!onoff) dev->meas_state = ALS21C_MEAS_IDLE;
+    set_reg_sysm_ctrl(dev);
+  }
+
+  /*!
+   * @brief  switch ambient light sensor on for a single measurement
+   */
+  static void enable_once(als21c_dev_t *dev, bool onoff) {
+    dev->data.en_once = onoff ? 0x1 : 0x0;
+    set_reg_sysm_ctrl(dev);
+  }
+
+  /*!
+   * @brief  set the ambient light sensor gain
+   * @param  pdsel new value for pd_sel
+   * @param  pdals new value for pd_als
+   */
+  static void set_gain(als21c_dev_t *dev, uint8_t pdsel, als21c_gain_t pdals) {
+    /* pd_sel == 1 for gain*2 */
+    dev->data.pd_sel = pdsel & 0x1;
+    /* pd_als */
+    dev->data.pga_als = pdals;
+    /* write gain */
+    set_reg_als_gain(dev);
+  }
+
+  /*!
+   * @brief  set the ambient light sensor gain
+   * @param  gain
+   *         actual gain is power of two between 1 and 512
+   */
+  static void set_gain_value(als21c_dev_t *dev, uint32_t gain) {
+    if (gain <= 1) set_gain(dev, 0, ALS21C_GAIN_1X);
+    else if (gain <= 2) set_gain(dev, 1, ALS21C_GAIN_1X);
+    else if (gain <= 4) set_gain(dev, 0, ALS21C_GAIN_4X);
+    else if (gain <= 8) set_gain(dev, 1, ALS21C_GAIN_4X);
+    else if (gain <= 16) set_gain(dev, 0, ALS21C_GAIN_16X);
+    else if (gain <= 32) set_gain(dev, 1, ALS21C_GAIN_16X);
+    else if (gain <= 64) set_gain(dev, 0, ALS21C_GAIN_64X);
+    else if (gain <= 128) set_gain(dev, 1, ALS21C_GAIN_64X);
+    else if (gain <= 256) set_gain(dev, 0, ALS21C_GAIN_256X);
+    else set_gain(dev, 1, ALS21C_GAIN_256X);
+    return;
+  }
+
+  /*!
+   * @brief  set the integration time for the ADC
+   * @param  itime
+   * @param  icount
+   */
+  static void set_integration(als21c_dev_t *dev, als21c_int_time_t itime, uint8_t icount) {
+    dev->data.int_time = itime;
+    dev->data.als_conv = icount;
+    set_reg_als_time(dev);
+  }
+
+  /*!
+   * @brief  set the integration time for the ADC in units of 1.17ms
+   * @param  count
+   *         integration time in units of 1.17 milliseconds
+   */
+  static void set_integration_time(als21c_dev_t *dev, uint32_t count) {
+    if (count == 0) set_integration(dev, ALS21C_INT_TIME_1T, 0);
+    else if (count <= 16) set_integration(dev, ALS21C_INT_TIME_1T, count - 1);
+    else if (count <= 4 * 16) set_integration(dev, ALS21C_INT_TIME_4T, count / 4 - 1);
+    else if (count <= 16 * 16) set_integration(dev, ALS21C_INT_TIME_16T, count / 16 - 1);
+    else if (count <= 64 * 16) set_integration(dev, ALS21C_INT_TIME_64T, count / 64 - 1);
+    else set_integration(dev, ALS21C_INT_TIME_64T, 15); /* maximum value */
+  }
+
+  /*!
+   * @brief  set the integration time for the ADC in milliseconds
+   * @param  millisec
+   *         integration time in milliseconds
+   */
+  static void set_integration_time_millisec(als21c_dev_t *dev, uint32_t millisec) {
+    uint32_t count;
+    count = (millisec * 416) / 487; /* 416/487 = 1.17ms */
+    set_integration_time(dev, count);
+  }
+
+  /*!
+   * @brief  set the wait time between two measurements
+   * @param  millisec
+   */
+  static void set_wait(als21c_dev_t *dev, als21c_wait_time_t unit, uint8_t count) {
+    dev->data.wtime_unit = unit;
+    dev->data.wtime = count;
+    set_reg_wait_time(dev);
+  }
+
+  /*!
+   * @brief  set the wait time between two measurements in milliseconds
+   * @param  millisec
+   *         wait time 0 switches waiting off
+   */
+  static void set_wait_time_millisec(als21c_dev_t *dev, uint16_t millisec) {
+
+    if (millisec <= 8) set_wait(dev, ALS21C_WAIT_TIME_1T, 0);
+    else if (millisec <= 512) set_wait(dev, ALS21C_WAIT_TIME_1T, millisec / 8 - 1);
+    else if (millisec <= 1024) set_wait(dev, ALS21C_WAIT_TIME_2T, millisec / 16 - 1);
+    else if (millisec <= 2048) set_wait(dev, ALS21C_WAIT_TIME_4T, millisec / 32 - 1);
+    else if (millisec <= 4096) set_wait(dev, ALS21C_WAIT_TIME_8T, millisec / 64 - 1);
+    else set_wait(dev, ALS21C_WAIT_TIME_8T, 0x3f); /* maximum value */
+
+    /* disable wait if millisec == 0 */
+    if (millisec == 0)
+      dev->data.en_wait = 0x0;
+    else
+      dev->data.en_wait = 0x1;
+    set_reg_sysm_ctrl(dev);
+  }
+
+  /*!
+   * @brief  return raw ALS count
+   * @return count
+   *         positive or zero value is als count
+   *         negative value is error condition
+   *         ALS21C_ERR_SATURATION: error in the analog part (amplifier, comparator)
+   *         ALS21C_ERR_NOT_READY: reading too soon (sensor still counting)
+   */
+  static int32_t read_als(als21c_dev_t *dev) {
+    uint16_t count;
+    count = get_reg_data(dev);
+    if (!dev->data.data_ready) return ALS21C_ERR_NOT_READY;
+    if (dev->data.saturation_als || dev->data.saturation_comp) return ALS21C_ERR_SATURATION;
+    return count;
+  }
+
+  static void increase_gain(als21c_dev_t *dev) {
+    if (dev->data.pd_sel == 0) {
+      /* double gain */
+      dev->data.pd_sel = 1;
+      set_reg_als_gain(dev);
+    } else if (dev->data.pga_als != ALS21C_GAIN_256X) {
+      /* more gain */
+      dev->data.pga_als <<= 1;
+      dev->data.pd_sel = 0;
+      set_reg_als_gain(dev);
+    } else if (dev->data.int_time != ALS21C_INT_TIME_64T) {
+      /* increase int_time */
+      dev->data.int_time++;
+      set_reg_als_time(dev);
+    } else if (dev->data.als_conv < 15) {
+      /* increase als_conv */
+      dev->data.als_conv++;
+      set_reg_als_time(dev);
+    }
+  }
+
+  static void decrease_gain(als21c_dev_t *dev) {
+    if (dev->data.als_conv > 0) {
+      /* decrease als_conv */
+      --dev->data.als_conv;
+      set_reg_als_time(dev);
+    } else if (dev->data.int_time != ALS21C_INT_TIME_1T) {
+      /* decrease int_time */
+      --dev->data.int_time;
+      set_reg_als_time(dev);
+    } else if (dev->data.pd_sel == 1) {
+      /* halve gain */
+      dev->data.pd_sel = 0;
+      set_reg_als_gain(dev);
+    } else if (dev->data.pga_als != ALS21C_GAIN_1X) {
+      /* less gain */
+      dev->data.pga_als >>= 1;
+      dev->data.pd_sel = 1;
+      set_reg_als_gain(dev);
+    }
+  }
+
+  /*!
+   * @brief  clock used for deadlines
+   * @return microseconds. wraps around.
+   */
+  static uint32_t micros(als21c_dev_t *dev) {
+    return Transport::micros(dev);
+  }
+
+  /*!
+   * @brief  start measurement, without waiting for the result
+   * @param  once
+   *         true: single measurement (en_once). false: continuous measurement.
+   * @return deadline: time the first sample is ready, in microseconds of micros().
+   *         pass the time to poll() to get the sample.
+   */
+  static uint32_t start(als21c_dev_t *dev, bool once) {
+    bool idle = !dev->data.en_als && dev->meas_state != ALS21C_MEAS_SINGLE;
+    if (once)
+      dev->data.en_once = 0x1;
+    else
+      dev->data.en_als = 0x1;
+    set_reg_sysm_ctrl(dev);
+    if (dev->shadow_defer) commit(dev);
+    if (idle) als21c_config_started(dev, Transport::micros(dev) + Transport::clock_res_us);
+    dev->meas_state = once ? ALS21C_MEAS_SINGLE : ALS21C_MEAS_CONTINUOUS;
+    als21c_meas_restart(dev);
+    dev->meas_deadline_us = dev->config_ready_us + Transport::clock_res_us;
+    if (!dev->config_pending) {
+      uint32_t period_us = als21c_get_period(dev);
+      dev->meas_deadline_us = Transport::micros(dev) + period_us + period_us / 8 + Transport::clock_res_us;
+    }
+    return dev->meas_deadline_us;
+  }
+
+  /*!
+   * @brief  start continuous measurement at the highest rate
+   *         integration time 1T, no wait, no auto lux; gain is kept.
+   *         one sample every 1.17 ms. read samples with poll().
+   *         attach a tracker first, als21c_set_track(), for poll() to follow the sensor clock.
+   * @return deadline: time the first sample is ready, in microseconds of micros().
+   */
+  static uint32_t stream_start(als21c_dev_t *dev) {
+    dev->shadow_defer = true;
+    dev->data.auto_lux = ALS21C_AUTO_LUX_OFF;
+    dev->data.en_wait = 0x0;
+    set_integration(dev, ALS21C_INT_TIME_1T, 0);
+    return start(dev, false);
+  }
+
+  /*!
+   * @brief  non-blocking measurement step. does not touch the bus before the deadline.
+   * @param  now_us
+   *         current time, from micros()
+   * @return lux, or ALS21C_ERR_NOT_READY if there is no new sample, or an error.
+   *         after a sample, the deadline is set to the next sample.
+   *         a single measurement ends after one sample; start() it again.
+   */
+  static int32_t poll(als21c_dev_t *dev, uint32_t now_us) {
+    uint32_t t0_us, t1_us;
+    int32_t lux;
+
+    if (dev->meas_state == ALS21C_MEAS_IDLE) return ALS21C_ERR_NOT_READY;
+    if ((int32_t)(now_us - dev->meas_deadline_us) < 0) return ALS21C_ERR_NOT_READY;
+
+    t0_us = Transport::micros(dev) - Transport::clock_res_us;
+    lux = read_lux(dev);
+    t1_us = Transport::micros(dev) + Transport::clock_res_us;
+    if (lux == ALS21C_ERR_NOT_READY) {
+      /* sensor slower than expected, or sample discarded */
+      if (dev->config_pending && (int32_t)(dev->config_ready_us - t1_us) > 0)
+        dev->meas_deadline_us = dev->config_ready_us + Transport::clock_res_us;
+      else
+        als21c_meas_early(dev, t0_us, t1_us);
+      return lux;
+    }
+
+    if (dev->meas_state == ALS21C_MEAS_SINGLE) {
+      /* the sensor clears en_once after the measurement */
+      dev->data.en_once = 0x0;
+      dev->shadow[ALS21C_REG_SYSM_CTRL] &= ~0x02;
+      dev->meas_state = ALS21C_MEAS_IDLE;
+    } else if (dev->config_pending) {
+      /* auto lux changed the configuration */
+      als21c_meas_restart(dev);
+      dev->meas_deadline_us = dev->config_ready_us + Transport::clock_res_us;
+    } else {
+      als21c_meas_sampled(dev, t0_us, t1_us);
+    }
+    return lux;
+  }
+
+  /*!
+   * @brief  set gain and integration time to range
+   * @param  range
+   *         0 (least sensitive) to ALS21C_RANGE_MAX (most sensitive)
+   *         gain and integration time are written in one burst
+   */
+  static void set_range(als21c_dev_t *dev, uint8_t range) {
+    bool defer = dev->shadow_defer;
+    if (range > ALS21C_RANGE_MAX) range = ALS21C_RANGE_MAX;
+    dev->shadow_defer = true;
+    set_gain_value(dev, als21c_range_gain(range));
+    if (range < 10)
+      set_integration(dev, ALS21C_INT_TIME_1T, 0);
+    else if (range < 13)
+      set_integration(dev, (als21c_int_time_t)(range - 9), 0);
+    else
+      set_integration(dev, ALS21C_INT_TIME_64T, range - 12);
+    if (!defer) commit(dev);
+  }
+
+  /*!
+   * @brief  return ALS light intensity in lux
+   * @return lux
+   *         positive or zero value is lux
+   *         negative value is error condition
+   *         ALS21C_ERR_SATURATION: error in the analog part (amplifier, comparator)
+   *         ALS21C_ERR_OVERFLOW: error in the digital part (counter)
+   *         ALS21C_ERR_NOT_READY: reading too soon (sensor still counting)
+   */
+  static int32_t read_lux(als21c_dev_t *dev) {
+    int32_t count, max_count;
+    int32_t lux;
+    uint16_t gain, itime;
+    uint8_t flags = 0;
+    uint32_t t0_us = 0;
+    bool pending = dev->config_pending;
+    uint8_t gen = dev->config_gen;
+
+    if (pending) t0_us = Transport::micros(dev) - Transport::clock_res_us;
+    count = get_reg_data(dev);
+    if (!dev->data.data_ready) return ALS21C_ERR_NOT_READY;
+
+    /* sample measured before the last configuration change */
+    if (pending) {
+      uint32_t t1_us = Transport::micros(dev) + Transport::clock_res_us;
+      als21c_sample_t sample = als21c_sample_config(dev, t0_us, t1_us);
+      if (sample == ALS21C_SAMPLE_STALE) return ALS21C_ERR_NOT_READY; /* discard */
+      if (sample == ALS21C_SAMPLE_OLD) return old_lux(dev, count);
+    }
+
+    max_count = als21c_get_max_count(dev);
+    gain = als21c_get_gain_value(dev);
+    itime = als21c_get_integration_time(dev);
+
+    /* convert adc count to lux */
+    lux = als21c_count_to_lux(dev, count);
+
+    /* automatic configuration of gain and integration time */
+    if (dev->data.auto_lux == ALS21C_AUTO_LUX_STEP) {
+      if (dev->data.saturation_als || dev->data.saturation_comp || (count > max_count - max_count / 4))
+        decrease_gain(dev);
+      else if (count < max_count / 4)
+        increase_gain(dev);
+    } else if (dev->data.auto_lux == ALS21C_AUTO_LUX_PREDICT) {
+      int8_t range = als21c_auto_lux_range(dev, count, dev->data.saturation_als || dev->data.saturation_comp);
+      if (range >= 0) set_range(dev, range);
+    }
+    if (dev->config_gen != gen) flags |= ALS21C_FLAG_RANGE;
+
+    if (dev->data.saturation_als || dev->data.saturation_comp) {
+      flags |= ALS21C_FLAG_SATURATION;
+      lux = ALS21C_ERR_SATURATION; /* analog */
+    } else if (count >= max_count) {
+      flags |= ALS21C_FLAG_OVERFLOW;
+      lux = ALS21C_ERR_OVERFLOW; /* digital */
+    }
+
+    track_sample(dev, gain, itime, flags);
+    return lux;
+  }
+
+  /*!
+   * @brief  enable or disable interrupt
+   * @param  onoff
+   */
+  static void enable_interrupt(als21c_dev_t *dev, bool onoff) {
+    dev->data.en_aint = onoff ? 0x1 : 0x0;
+    set_reg_int_ctrl(dev);
+  }
+
+  /*!
+   * @brief  set ALS synchronisation
+   * @param  onoff
+   *         when enabled, ALS light measurement waits until interrupt is cleared
+   */
+  static void enable_als_sync(als21c_dev_t *dev, bool onoff) {
+    dev->data.als_sync = onoff ? 0x1 : 0x0;
+    set_reg_int_ctrl(dev);
+  }
+
+  /*!
+   * @brief  get ALS interrupt status
+   * @return true if interrupt pending
+   */
+  static bool interrupt_status(als21c_dev_t *dev) {
+    get_reg_int_flag(dev);
+    return dev->data.int_por || dev->data.int_als;
+  }
+
+  /*!
+   * @brief  clear ALS interrupt
+   */
+  static void clear_interrupt(als21c_dev_t *dev) {
+    write8(dev, ALS21C_REG_INT_FLAG, 0x0);
+  }
+
+  /*!
+   * @brief  set interrupt persistence
+   * @param  pers
+   *         sets number of consecutive measurements that have to be outside threshold to trigger an interrupt
+   *         if pers is zero, thresholds are ignored and every measurement triggers an interrupt
+   */
+  static void set_persistence(als21c_dev_t *dev, uint8_t pers) {
+    if (pers > 15) pers = 15;
+    dev->data.prs_als = pers;
+    set_reg_persistence(dev);
+  }
+
+  /*!
+   * @brief  set lower threshold for ALS count to trigger an interrupt
+   * @param  value
+   */
+  static void set_low_threshold(als21c_dev_t *dev, uint16_t value) {
+    write16(dev, ALS21C_REG_ALS_THRES_L, value);
+  }
+
+  /*!
+   * @brief  set upper threshold for ALS count to trigger an interrupt
+   * @param  value
+   */
+  static void set_high_threshold(als21c_dev_t *dev, uint16_t value) {
+    write16(dev, ALS21C_REG_ALS_THRES_H, value);
+  }
+
+  /*!
+   * @brief  set lower and upper threshold in a single burst write
+   * @param  low
+   * @param  high
+   *         an interrupt is triggered when the ALS count is below low or above high
+   */
+  static void set_thresholds(als21c_dev_t *dev, uint16_t low, uint16_t high) {
+    uint8_t buf[4] = { uint8_t(low & 0xff), uint8_t(low >> 8), uint8_t(high & 0xff), uint8_t(high >> 8) };
+    write(dev, ALS21C_REG_ALS_THRES_L, buf, sizeof(buf));
+  }
+
+  /*!
+   * @brief  start interrupt pipeline
+   * @param  pers
+   *         number of consecutive measurements outside the window before an interrupt.
+   *         goes up automatically with noise or flicker, and back down when quiet.
+   *         the first interrupt comes after pers measurements.
+   */
+  static void irq_enable(als21c_irq_t *irq, uint8_t pers) {
+    als21c_dev_t *dev = irq->dev;
+    if (pers < 1) pers = 1;
+    if (pers > 15) pers = 15;
+    irq->pers = irq->pers_min = pers;
+    irq->window = ALS21C_WINDOW_OPEN;
+    irq->prev_lux = -1;
+    irq_rearm(irq);
+    clear_interrupt(dev);
+    enable_interrupt(dev, true);
+  }
+
+  /*!
+   * @brief  interrupt handler. Only queues the time; no bus access.
+   */
+  static void irq_isr(als21c_irq_t *irq) {
+    als21c_irq_event(irq, Transport::micros(irq->dev));
+  }
+
+  /*!
+   * @brief  deferred interrupt handling. Call outside interrupt context, often.
+   *         reads the sample in one burst, moves the threshold window to it,
+   *         clears INT_FLAG and queues the reading.
+   *         without interrupt, only checks the thresholds still match gain
+   *         and integration time, and lowers persistence when quiet.
+   * @return number of readings queued, 0 or 1
+   */
+  static int irq_handle(als21c_irq_t *irq) {
+    als21c_dev_t *dev = irq->dev;
+    als21c_reading_t reading;
+    uint32_t t_us;
+
+    if (!als21c_irq_next_event(irq, &t_us)) {
+      /* configuration changed: thresholds in counts have to follow. quiet: lower persistence */
+      if (irq->window_gen != dev->config_gen || (irq->pers > irq->pers_min && als21c_irq_relax(irq, Transport::micros(dev))))
+        irq_rearm(irq);
+      return 0;
+    }
+    reading.lux = read_lux(dev);
+    reading.count = dev->data.als_data;
+    reading.config_gen = dev->config_gen;
+    reading.t_us = t_us;
+
+    if (reading.lux != ALS21C_ERR_NOT_READY) als21c_irq_update(irq, reading.lux, t_us);
+    irq_rearm(irq);
+    clear_interrupt(dev);
+
+    if (reading.lux == ALS21C_ERR_NOT_READY) return 0;
+    als21c_irq_push(irq, &reading);
+    return 1;
+  }
+
+  /*!
+   * @brief  get ALS product id
+   * @return product id
+   */
+  static uint16_t get_product_id(als21c_dev_t *dev) {
+    return read16(dev, ALS21C_REG_PROD_ID);
+  }
+
+  /*!
+   * @brief  write all changed registers, using burst writes for contiguous registers
+   *         sysm_ctrl last: the sensor takes gain and integration time at the
+   *         start of a measurement.
+   */
+  static void commit(als21c_dev_t *dev) {
+    dev->shadow_defer = false;
+    if (!dev->shadow_dirty) return;
+    commit_range(dev, ALS21C_REG_INT_CTRL, ALS21C_REG_INT_CTRL);
+    commit_range(dev, ALS21C_REG_WAIT_TIME, ALS21C_REG_ALS_TIME);
+    if (dev->shadow_dirty & (1 << ALS21C_SHADOW_PERSISTENCE)) {
+      write8(dev, ALS21C_REG_PERSISTENCE, dev->shadow[ALS21C_SHADOW_PERSISTENCE]);
+      dev->shadow_dirty &= ~(1 << ALS21C_SHADOW_PERSISTENCE);
+    }
+    commit_range(dev, ALS21C_REG_SYSM_CTRL, ALS21C_REG_SYSM_CTRL);
+  }
+
+  /* sysm_ctrl register */
+  static void set_reg_sysm_ctrl(als21c_dev_t *dev) {
+    uint8_t dta = dev->data.swrst << 7 | dev->data.en_wait << 6 | dev->data.en_frst << 5 | dev->data.en_once << 1 | dev->data.en_als;
+    if (dev->data.swrst)
+      write8(dev, ALS21C_REG_SYSM_CTRL, dta); /* reset is never held back */
+    else
+      set_shadow(dev, ALS21C_REG_SYSM_CTRL, dta);
+  }
+
+  /* int_ctrl register */
+  static void set_reg_int_ctrl(als21c_dev_t *dev) {
+    uint8_t dta = dev->data.als_sync << 4 | dev->data.en_aint;
+    set_shadow(dev, ALS21C_REG_INT_CTRL, dta);
+  }
+
+  /* set interrupt flag register */
+  static void set_reg_int_flag(als21c_dev_t *dev) {
+    uint8_t dta = dev->data.int_por << 7 | dev->data.data_flag << 6 | dev->data.int_als;
+    write8(dev, ALS21C_REG_INT_FLAG, dta);
+  }
+
+  /* get interrupt flag register */
+  static void get_reg_int_flag(als21c_dev_t *dev) {
+    uint8_t data = read8(dev, ALS21C_REG_INT_FLAG);
+    dev->data.int_por = (data >> 7) & 0x1;
+    dev->data.data_flag = (data >> 6) & 0x1;
+    dev->data.int_als = data & 0x1;
+  }
+
+  /* wait_time register */
+  static void set_reg_wait_time(als21c_dev_t *dev) {
+    uint8_t dta = dev->data.wtime_unit << 6 | dev->data.wtime;
+    set_shadow(dev, ALS21C_REG_WAIT_TIME, dta);
+  }
+
+  /* als_gain register */
+  static void set_reg_als_gain(als21c_dev_t *dev) {
+    uint8_t dta = dev->data.pd_sel << 7 | dev->data.pga_als;
+    set_shadow(dev, ALS21C_REG_ALS_GAIN, dta);
+  }
+
+  /* als_time register */
+  static void set_reg_als_time(als21c_dev_t *dev) {
+    uint8_t dta = dev->data.als_conv << 4 | dev->data.int_time;
+    set_shadow(dev, ALS21C_REG_ALS_TIME, dta);
+  }
+
+  /* persistence register */
+  static void set_reg_persistence(als21c_dev_t *dev) {
+    uint8_t dta = dev->data.int_src << 4 | dev->data.prs_als;
+    set_shadow(dev, ALS21C_REG_PERSISTENCE, dta);
+  }
+
+  /* data status register */
+  static void get_reg_data_status(als21c_dev_t *dev) {
+    uint8_t data = read8(dev, ALS21C_REG_DATA_STATUS);
+    dev->data.data_ready = (data >> 7) & 0x1;
+    dev->data.saturation_als = (data >> 1) & 0x1;
+    dev->data.saturation_comp = data & 0x1;
+  }
+
+  /* data status and als data register, in a single burst read */
+  static uint16_t get_reg_data(als21c_dev_t *dev) {
+    uint8_t buf[ALS21C_BURST_LEN];
+    if (!read(dev, ALS21C_REG_DATA_STATUS, buf, sizeof(buf)))
+      memset(buf, 0, sizeof(buf));
+    uint8_t data = buf[0];
+    dev->data.data_ready = (data >> 7) & 0x1;
+    dev->data.saturation_als = (data >> 1) & 0x1;
+    dev->data.saturation_comp = data & 0x1;
+    uint8_t *als_data = &buf[ALS21C_REG_ALS_DATA - ALS21C_REG_DATA_STATUS];
+    dev->data.als_data = als_data[0] | uint16_t(als_data[1]) << 8;
+    return dev->data.als_data;
+  }
+
+  /* I2C operations */
+
+  static bool read(als21c_dev_t *dev, const uint8_t reg, uint8_t *data, const uint8_t len) {
+    dev->transactions++;
+    if (Transport::read(dev, reg, data, len)) return true;
+    dev->errors++;
+    return false;
+  }
+
+  static bool write(als21c_dev_t *dev, const uint8_t reg, const uint8_t *data, const uint8_t len) {
+    bool config = is_config(reg, len);
+    uint32_t t0_us = 0;
+    bool ok;
+    if (config) t0_us = Transport::micros(dev) - Transport::clock_res_us;
+    dev->transactions++;
+    ok = Transport::write(dev, reg, data, len);
+    if (!ok) dev->errors++;
+    if (config) als21c_config_changed(dev, t0_us, Transport::micros(dev) + Transport::clock_res_us);
+    return ok;
+  }
+
+  static void write8(als21c_dev_t *dev, const uint8_t reg, const uint8_t data) {
+    write(dev, reg, &data, 1);
+  }
+
+  static void write16(als21c_dev_t *dev, const uint8_t reg, const uint16_t data) {
+    uint8_t buf[2] = { uint8_t(data & 0xff), uint8_t(data >> 8) };
+    write(dev, reg, buf, 2);
+  }
+
+  static uint8_t read8(als21c_dev_t *dev, const uint8_t reg) {
+    uint8_t data;
+    if (!read(dev, reg, &data, 1)) return 0;
+    return data;
+  }
+
+  static uint16_t read16(als21c_dev_t *dev, const uint8_t reg) {
+    uint8_t buf[2];
+    if (!read(dev, reg, buf, 2)) return 0;
+    return buf[0] | uint16_t(buf[1]) << 8;
+  }
+
+private:
+  /* write persistence and thresholds, registers 0x0B..0x0F, in one burst */
+  static void irq_rearm(als21c_irq_t *irq) {
+    als21c_dev_t *dev = irq->dev;
+    uint16_t low, high;
+    uint8_t buf[5];
+    als21c_irq_window(irq, &low, &high);
+    dev->data.prs_als = irq->pers;
+    buf[0] = dev->data.int_src << 4 | dev->data.prs_als;
+    buf[1] = low & 0xff;
+    buf[2] = low >> 8;
+    buf[3] = high & 0xff;
+    buf[4] = high >> 8;
+    write(dev, ALS21C_REG_PERSISTENCE, buf, sizeof(buf));
+    dev->shadow[ALS21C_SHADOW_PERSISTENCE] = buf[0];
+    dev->shadow_valid |= 1 << ALS21C_SHADOW_PERSISTENCE;
+    dev->shadow_dirty &= ~(1 << ALS21C_SHADOW_PERSISTENCE);
+    irq->window_gen = dev->config_gen;
+  }
+
+  /* what the sample read was measured with, if tracked */
+  static void track_sample(als21c_dev_t *dev, uint16_t gain, uint16_t itime, uint8_t flags) {
+    als21c_track_t *track = dev->track;
+    if (track == NULL) return;
+    track->gain = gain;
+    track->itime = itime;
+    track->flags = flags;
+  }
+
+  /* lux of sample measured with the configuration before the last change. no auto lux; a change is underway. */
+  static int32_t old_lux(als21c_dev_t *dev, uint16_t count) {
+    int32_t max_count = 1024 * dev->config_old_itime - 1;
+    if (max_count > 0xffff) max_count = 0xffff;
+    if (dev->data.saturation_als || dev->data.saturation_comp) {
+      track_sample(dev, dev->config_old_gain, dev->config_old_itime, ALS21C_FLAG_OLD | ALS21C_FLAG_SATURATION);
+      return ALS21C_ERR_SATURATION;
+    } else if (count >= max_count) {
+      track_sample(dev, dev->config_old_gain, dev->config_old_itime, ALS21C_FLAG_OLD | ALS21C_FLAG_OVERFLOW);
+      return ALS21C_ERR_OVERFLOW;
+    }
+    track_sample(dev, dev->config_old_gain, dev->config_old_itime, ALS21C_FLAG_OLD);
+    return als21c_count_to_lux_config(count, dev->config_old_gain, dev->config_old_itime);
+  }
+
+  /* true if a write to reg..reg+len-1 changes the measurement */
+  static bool is_config(const uint8_t reg, const uint8_t len) {
+    for (uint8_t r = reg; r < reg + len; r++)
+      if (r == ALS21C_REG_SYSM_CTRL || r == ALS21C_REG_WAIT_TIME || r == ALS21C_REG_ALS_GAIN || r == ALS21C_REG_ALS_TIME)
+        return true;
+    return false;
+  }
+
+  /*
+   * register shadow.
+   * shadow[] holds the value of the configuration registers 0x00..0x05 and
+   * persistence. A register is only written if its value changes.
+   * When writes are deferred, changes are collected in shadow[] and written
+   * by commit(), contiguous registers in a single burst write.
+   * INT_FLAG is not shadowed; writing INT_FLAG clears interrupts.
+   */
+
+  /* index in shadow[] of register */
+  static uint8_t shadow_index(uint8_t reg) {
+    if (reg == ALS21C_REG_PERSISTENCE) return ALS21C_SHADOW_PERSISTENCE;
+    return reg;
+  }
+
+  /* write register through shadow */
+  static void set_shadow(als21c_dev_t *dev, uint8_t reg, uint8_t dta) {
+    uint8_t idx = shadow_index(reg);
+    uint8_t bit = 1 << idx;
+    bool same = (dev->shadow_valid & bit) && dev->shadow[idx] == dta;
+    if (same && !(dev->shadow_dirty & bit)) return; /* no change */
+    dev->shadow[idx] = dta;
+    dev->shadow_valid |= bit;
+    if (dev->shadow_defer) {
+      dev->shadow_dirty |= bit;
+      return;
+    }
+    dev->shadow_dirty &= ~bit;
+    write8(dev, reg, dta);
+  }
+
+  /* write dirty registers first..last in as few transactions as possible */
+  static void commit_range(als21c_dev_t *dev, uint8_t first, uint8_t last) {
+    uint8_t reg = first;
+    while (reg <= last) {
+      uint8_t end;
+      if (!(dev->shadow_dirty & (1 << reg))) {
+        reg++;
+        continue;
+      }
+      /* extend burst over dirty registers and clean registers with known value */
+      end = reg;
+      for (uint8_t r = reg + 1; r <= last && (dev->shadow_valid & (1 << r)); r++)
+        if (dev->shadow_dirty & (1 << r)) end = r;
+      if (end == reg)
+        write8(dev, reg, dev->shadow[reg]);
+      else
+        write(dev, reg, &dev->shadow[reg], end - reg + 1);
+      for (uint8_t r = reg; r <= end; r++)
+        dev->shadow_dirty &= ~(1 << r);
+      reg = end + 1;
+    }
+  }
+};
+
+} /* namespace als21c */
+
+#endif
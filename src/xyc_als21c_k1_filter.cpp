@@ -0,0 +1,145 @@
+/*!
+ *
+ * 	I2C Driver for NEWOPT XYC_ALS21C ambient light sensor
+ *
+ * 	This is a library for the NEWOPT XYC_ALS21C breakout:
+ * 	http://oshwlab.com/koendv/xyc_als21c_k1
+ *
+ *      filters for a stream of samples, to smooth and reduce high-rate
+ *      sampling on the microcontroller. integer math, fixed memory.
+ */
+
+#include <cstring>
+#include <xyc_als21c_k1.h>
+
+namespace als21c {
+
+/*!
+ * @brief  initialize moving average
+ * @param  shift
+ *         each sample moves the average 1 / 2^shift of the way, 0 to 15.
+ *         about 2^shift samples of memory. 0 passes samples through.
+ */
+void als21c_ema_init(als21c_ema_t *ema, uint8_t shift) {
+  ema->acc = 0;
+  ema->shift = shift > 15 ? 15 : shift;
+  ema->init = false;
+}
+
+/*!
+ * @brief  add a sample to the moving average
+ * @param  value
+ *         any int32_t
+ * @return average
+ *         the first sample starts the average.
+ */
+int32_t als21c_ema_update(als21c_ema_t *ema, int32_t value) {
+  int64_t x = (int64_t)value * 65536;
+  if (!ema->init) {
+    ema->acc = x;
+    ema->init = true;
+  }
+  /* round the step, not floor it: a floored step never follows a small rise */
+  ema->acc += (x - ema->acc + ((1 << ema->shift) >> 1)) >> ema->shift;
+  return (int32_t)((ema->acc + 32768) >> 16);
+}
+
+/*!
+ * @brief  initialize running median
+ * @param  n
+ *         samples, odd, up to ALS21C_MEDIAN_MAX. even n is rounded up. 1 passes samples through.
+ *         a median of 3 removes single spikes, a median of 5 two spikes in a row.
+ */
+void als21c_median_init(als21c_median_t *median, uint8_t n) {
+  memset(median, 0, sizeof(*median));
+  n |= 1;
+  median->n = n > ALS21C_MEDIAN_MAX ? ALS21C_MEDIAN_MAX : n;
+}
+
+/*!
+ * @brief  add a sample to the running median
+ * @return median of the last n samples; of all samples, until there are n.
+ *         at most 2 n compares and moves per sample.
+ */
+int32_t als21c_median_update(als21c_median_t *median, int32_t value) {
+  uint8_t i;
+  if (median->count == median->n) {
+    /* remove oldest */
+    int32_t oldest = median->ring[median->pos];
+    for (i = 0; median->sorted[i] != oldest; i++)
+      ;
+    for (; i + 1 < median->count; i++)
+      median->sorted[i] = median->sorted[i + 1];
+    median->count--;
+  }
+  /* insert newest */
+  for (i = median->count; i > 0 && median->sorted[i - 1] > value; i--)
+    median->sorted[i] = median->sorted[i - 1];
+  median->sorted[i] = value;
+  median->count++;
+  median->ring[median->pos] = value;
+  if (++median->pos == median->n) median->pos = 0;
+  return median->sorted[median->count / 2];
+}
+
+/*!
+ * @brief  initialize decimation
+ * @param  n
+ *         samples in, per sample out. 1 passes samples through.
+ */
+void als21c_decimate_init(als21c_decimate_t *decimate, uint16_t n) {
+  decimate->sum = 0;
+  decimate->n = n == 0 ? 1 : n;
+  decimate->count = 0;
+}
+
+/*!
+ * @brief  add a sample to the decimation
+ * @param  out
+ *         mean of the last n samples, rounded
+ * @return true every n samples, when there is an output
+ */
+bool als21c_decimate_update(als21c_decimate_t *decimate, int32_t value, int32_t *out) {
+  decimate->sum += value;
+  if (++decimate->count < decimate->n) return false;
+  *out = (decimate->sum + decimate->n / 2) / decimate->n;
+  decimate->sum = 0;
+  decimate->count = 0;
+  return true;
+}
+
+/*!
+ * @brief  initialize filter pipeline
+ * @param  median_n
+ *         running median, samples. 1 is off.
+ * @param  ema_shift
+ *         moving average, 1 / 2^shift. 0 is off.
+ * @param  decimate_n
+ *         decimation, samples. 1 is off.
+ */
+void als21c_filter_init(als21c_filter_t *filter, uint8_t median_n, uint8_t ema_shift, uint16_t decimate_n) {
+  als21c_median_init(&filter->median, median_n);
+  als21c_ema_init(&filter->ema, ema_shift);
+  als21c_decimate_init(&filter->decimate, decimate_n);
+  filter->errors = 0;
+}
+
+/*!
+ * @brief  add a sample to the filter pipeline
+ * @param  value
+ *         lux, or count. negative errors are skipped and counted.
+ * @param  out
+ *         filtered value
+ * @return true if there is an output
+ */
+bool als21c_filter_sample(als21c_filter_t *filter, int32_t value, int32_t *out) {
+  if (value < 0) {
+    filter->errors++;
+    return false;
+  }
+  value = als21c_median_update(&filter->median, value);
+  value = als21c_ema_update(&filter->ema, value);
+  return als21c_decimate_update(&filter->decimate, value, out);
+}
+
+} /* namespace als21c */
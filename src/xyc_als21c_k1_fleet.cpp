@@ -0,0 +1,132 @@
+/*!
+ *
+ * 	I2C Driver for NEWOPT XYC_ALS21C ambient light sensor
+ *
+ * 	This is a library for the NEWOPT XYC_ALS21C breakout:
+ * 	http://oshwlab.com/koendv/xyc_als21c_k1
+ *
+ *      fleet: many sensors behind multiplexers, measuring at the same time.
+ *      all sensors have address ALS21C_I2C_ADDR; a multiplexer channel
+ *      carries one sensor. the integrations overlap; the bus only carries
+ *      the starts and the burst reads, in deadline order.
+ */
+
+#include <xyc_als21c_k1.h>
+
+namespace als21c {
+
+/* true if a before b: by bus, then multiplexer channel */
+static bool als21c_fleet_before(const als21c_dev_t *a, const als21c_dev_t *b) {
+  if (a->bus != b->bus) return (uintptr_t)a->bus < (uintptr_t)b->bus;
+  return a->mux_channel < b->mux_channel;
+}
+
+/* reading dev does not switch the multiplexer */
+static bool als21c_fleet_selected(const als21c_dev_t *dev) {
+  return dev->mux_channel == ALS21C_MUX_NONE || dev->bus == NULL || dev->bus->mux_channel == dev->mux_channel;
+}
+
+/*!
+ * @brief  initialize fleet, without sensors. does not access the bus.
+ */
+void als21c_fleet_init(als21c_fleet_t *fleet) {
+  fleet->n = 0;
+  fleet->once = false;
+}
+
+/*!
+ * @brief  add a sensor to the fleet. does not access the bus.
+ * @param  dev
+ *         initialized with als21c_init() and als21c_begin(). gain, integration
+ *         time and auto lux are the sensor's own.
+ * @return false if the fleet is full, ALS21C_FLEET_MAX sensors
+ */
+bool als21c_fleet_add(als21c_fleet_t *fleet, als21c_dev_t *dev) {
+  uint8_t i;
+  if (fleet->n >= ALS21C_FLEET_MAX) return false;
+  /* sorted: starts, and reads due at the same time, go channel after channel */
+  for (i = fleet->n; i > 0 && als21c_fleet_before(dev, fleet->dev[i - 1]); i--)
+    fleet->dev[i] = fleet->dev[i - 1];
+  fleet->dev[i] = dev;
+  fleet->n++;
+  return true;
+}
+
+/*!
+ * @brief  start all sensors, without waiting for the results
+ * @param  once
+ *         true: single measurements (en_once), started again after each read.
+ *         false: continuous measurement. the sensors start one after the
+ *         other, and stay staggered by the time of a start; in the order they are read.
+ * @return deadline: time the first reading is ready, in microseconds of micros().
+ */
+uint32_t als21c_fleet_start(als21c_fleet_t *fleet, bool once) {
+  fleet->once = once;
+  for (uint8_t i = 0; i < fleet->n; i++)
+    als21c_start(fleet->dev[i], once);
+  return als21c_fleet_deadline(fleet);
+}
+
+/*!
+ * @brief  non-blocking fleet step. reads at most one sensor with a sample ready.
+ *         of the sensors past their deadline, one on the multiplexer channel
+ *         selected now goes first, then the earliest deadline.
+ * @param  now_us
+ *         current time, from micros()
+ * @param  dev
+ *         sensor of the reading
+ * @return lux, or ALS21C_ERR_NOT_READY if no sensor has a sample, or an error.
+ *         call again until ALS21C_ERR_NOT_READY, then wait for als21c_fleet_deadline().
+ */
+int32_t als21c_fleet_poll(als21c_fleet_t *fleet, uint32_t now_us, als21c_dev_t **dev) {
+  for (;;) {
+    als21c_dev_t *next = NULL;
+    int32_t lux;
+    for (uint8_t i = 0; i < fleet->n; i++) {
+      als21c_dev_t *d = fleet->dev[i];
+      if (d->meas_state == ALS21C_MEAS_IDLE || (int32_t)(now_us - d->meas_deadline_us) < 0) continue;
+      if (als21c_fleet_selected(d)) {
+        next = d;
+        break;
+      }
+      if (next == NULL || (int32_t)(d->meas_deadline_us - next->meas_deadline_us) < 0) next = d;
+    }
+    if (next == NULL) return ALS21C_ERR_NOT_READY;
+
+    /* a sensor that has no sample yet moves its deadline past now */
+    lux = als21c_poll(next, now_us);
+    if (lux == ALS21C_ERR_NOT_READY) continue;
+    /* start again while the multiplexer channel is selected */
+    if (fleet->once) als21c_start(next, true);
+    *dev = next;
+    return lux;
+  }
+}
+
+/*!
+ * @brief  time to call als21c_fleet_poll() again
+ * @return earliest deadline of the sensors measuring, in microseconds of micros()
+ */
+uint32_t als21c_fleet_deadline(als21c_fleet_t *fleet) {
+  uint32_t deadline = 0;
+  bool found = false;
+  for (uint8_t i = 0; i < fleet->n; i++) {
+    als21c_dev_t *d = fleet->dev[i];
+    if (d->meas_state == ALS21C_MEAS_IDLE) continue;
+    if (!found || (int32_t)(d->meas_deadline_us - deadline) < 0) deadline = d->meas_deadline_us;
+    found = true;
+  }
+  return deadline;
+}
+
+/*!
+ * @brief  stop all sensors
+ */
+void als21c_fleet_stop(als21c_fleet_t *fleet) {
+  for (uint8_t i = 0; i < fleet->n; i++) {
+    fleet->dev[i]->data.en_once = 0x0;
+    als21c_enable(fleet->dev[i], false);
+  }
+}
+
+} /* namespace als21c */
@@ -0,0 +1,210 @@
+/*!
+ *
+ * 	I2C Driver for NEWOPT XYC_ALS21C ambient light sensor
+ *
+ * 	This is a library for the NEWOPT XYC_ALS21C breakout:
+ * 	http://oshwlab.com/koendv/xyc_als21c_k1
+ *
+ *      flicker analysis of a stream of samples.
+ *      Goertzel filters at the harmonics of mains frequency, percent flicker
+ *      and flicker index. integer math, fixed memory, no sample buffer.
+ */
+
+#include <cstring>
+#include <xyc_als21c_k1.h>
+
+namespace als21c {
+
+/* 2 cos(2 pi t), t in 1/65536 turn, 2.14 fixed point. taylor series to x^12, at init only */
+static int32_t als21c_flicker_coef(uint32_t t) {
+  static const uint8_t div[] = { 132, 90, 56, 30, 12, 2 };
+  const int64_t one = (int64_t)1 << 30;
+  int64_t theta, theta2, r;
+  bool neg = false;
+
+  t &= 0xffff;
+  if (t > 0x8000) t = 0x10000 - t;
+  if (t > 0x4000) {
+    t = 0x8000 - t;
+    neg = true;
+  }
+  /* radians, 2.30 fixed point */
+  theta = ((int64_t)t * 6746518852LL) >> 16;
+  theta2 = (theta * theta) >> 30;
+  r = one;
+  for (uint8_t i = 0; i < sizeof(div); i++)
+    r = one - ((theta2 * r) >> 30) / div[i];
+  if (neg) r = -r;
+  return (int32_t)((r + (1 << 14)) >> 15);
+}
+
+/* integer square root */
+static uint32_t als21c_isqrt64(uint64_t n) {
+  uint64_t root = 0, bit = 1ull << 62;
+  while (bit > n) bit >>= 2;
+  while (bit != 0) {
+    if (n >= root + bit) {
+      n -= root + bit;
+      root = (root >> 1) + bit;
+    } else {
+      root >>= 1;
+    }
+    bit >>= 2;
+  }
+  return (uint32_t)root;
+}
+
+/*!
+ * @brief  initialize flicker analysis
+ * @param  period_us
+ *         sample period, e.g. als21c_get_period(dev) after als21c_stream_start()
+ * @param  mains_hz
+ *         50 or 60
+ * @param  n
+ *         window, samples, up to ALS21C_FLICKER_MAX_N. a result every n / 2 samples.
+ *         frequency resolution is sample rate / n.
+ */
+void als21c_flicker_init(als21c_flicker_t *flicker, uint32_t period_us, uint16_t mains_hz, uint16_t n) {
+  uint8_t i;
+  memset(flicker, 0, sizeof(*flicker));
+  if (n < 16) n = 16;
+  if (n > ALS21C_FLICKER_MAX_N) n = ALS21C_FLICKER_MAX_N;
+  flicker->n = n & ~1u;
+  flicker->mains_hz = mains_hz;
+  for (i = 0; i < ALS21C_FLICKER_BINS; i++) {
+    /* frequency, in 1/65536 turn per sample */
+    uint32_t t = ((uint64_t)(i + 1) * mains_hz * period_us * 65536 + 500000) / 1000000;
+    if (t >= 0x8000) break;
+    flicker->coef[i] = als21c_flicker_coef(t);
+  }
+  flicker->bins = i;
+}
+
+/* start a window. level subtracted from the samples: a mean of earlier samples */
+static void als21c_flicker_start(als21c_flicker_t *flicker, als21c_flicker_window_t *w, int32_t value) {
+  const als21c_flicker_window_t *other = w == &flicker->window[0] ? &flicker->window[1] : &flicker->window[0];
+  memset(w, 0, sizeof(*w));
+  w->active = true;
+  w->valid = true;
+  if (flicker->have_mean)
+    w->ref = flicker->mean;
+  else if (other->active && other->n != 0)
+    w->ref = other->ref + (int32_t)(other->sum / other->n);
+  else {
+    w->ref = value;
+    w->valid = false;
+  }
+}
+
+/* window complete. true if there is a result */
+static bool als21c_flicker_end(als21c_flicker_t *flicker, als21c_flicker_window_t *w) {
+  als21c_flicker_result_t *r = &flicker->result;
+  uint32_t n = w->n;
+  int64_t total;
+  uint64_t ac, harm = 0;
+
+  flicker->mean = w->ref + (int32_t)(w->sum / (int64_t)n);
+  flicker->have_mean = true;
+  if (!w->valid) return false;
+
+  memset(r, 0, sizeof(*r));
+  r->mean = flicker->mean;
+  r->errors = w->errors;
+  if (w->max + w->min > 0) r->percent = (uint64_t)(w->max - w->min) * 10000 / (uint32_t)(w->max + w->min);
+  total = (int64_t)w->ref * n + w->sum;
+  if (total > 0) r->index = w->above * 1000 / (uint64_t)total;
+
+  /* amplitude at bin: 2 |X| / n, |X|^2 = s1^2 + s2^2 - coef s1 s2 */
+  for (uint8_t i = 0; i < flicker->bins; i++) {
+    int64_t a = w->s1[i], b = w->s2[i], p;
+    uint8_t shift = 0;
+    while (a >= (1ll << 30) || a <= -(1ll << 30) || b >= (1ll << 30) || b <= -(1ll << 30)) {
+      a >>= 1;
+      b >>= 1;
+      shift++;
+    }
+    p = a * a + b * b - ((flicker->coef[i] * a) >> 14) * b;
+    if (p < 0) p = 0;
+    r->amplitude[i] = (((uint64_t)als21c_isqrt64(p) << (shift + 1)) + n / 2) / n;
+    /* n^2 times the power of the harmonic, a^2 / 2 */
+    if ((uint64_t)p * 2 > (UINT64_MAX / ALS21C_FLICKER_BINS) >> (2 * shift))
+      harm += UINT64_MAX / ALS21C_FLICKER_BINS;
+    else
+      harm += ((uint64_t)p * 2) << (2 * shift);
+  }
+
+  /* n^2 times the variance */
+  ac = w->sum_sq * n - (uint64_t)(w->sum * w->sum);
+  if (harm >= ac)
+    r->mains = 1000;
+  else {
+    while (ac >= (1ull << 53)) {
+      ac >>= 1;
+      harm >>= 1;
+    }
+    r->mains = harm * 1000 / ac;
+  }
+
+  if (r->percent < ALS21C_FLICKER_MIN_PERCENT)
+    r->kind = ALS21C_FLICKER_NONE;
+  else if (r->mains >= 500)
+    r->kind = ALS21C_FLICKER_MAINS;
+  else
+    r->kind = ALS21C_FLICKER_OTHER;
+  flicker->ready = true;
+  return true;
+}
+
+/*!
+ * @brief  add one sample
+ * @param  value
+ *         lux, or count. negative errors are skipped, and counted in the result.
+ * @return true if a new result is ready
+ *         samples are assumed one sample period apart; a sample lost shifts
+ *         the phase of the filters. constant work per sample.
+ */
+bool als21c_flicker_sample(als21c_flicker_t *flicker, int32_t value) {
+  als21c_flicker_window_t *w0 = &flicker->window[0], *w1 = &flicker->window[1];
+  bool done = false;
+
+  if (!w0->active) als21c_flicker_start(flicker, w0, value);
+  if (!w1->active && w0->n == flicker->n / 2) als21c_flicker_start(flicker, w1, value);
+
+  for (uint8_t k = 0; k < 2; k++) {
+    als21c_flicker_window_t *w = &flicker->window[k];
+    if (!w->active) continue;
+    if (value < 0) {
+      w->errors++;
+      continue;
+    }
+    int32_t d = value - w->ref;
+    if (w->n == 0 || value < w->min) w->min = value;
+    if (w->n == 0 || value > w->max) w->max = value;
+    w->sum += d;
+    w->sum_sq += (uint64_t)((int64_t)d * d);
+    if (d > 0) w->above += d;
+    for (uint8_t i = 0; i < flicker->bins; i++) {
+      int64_t s0 = d + ((flicker->coef[i] * w->s1[i]) >> 14) - w->s2[i];
+      w->s2[i] = w->s1[i];
+      w->s1[i] = s0;
+    }
+    if (++w->n == flicker->n) {
+      done |= als21c_flicker_end(flicker, w);
+      als21c_flicker_start(flicker, w, value);
+    }
+  }
+  return done;
+}
+
+/*!
+ * @brief  last result
+ * @return true if the result is new since the last call
+ */
+bool als21c_flicker_read(als21c_flicker_t *flicker, als21c_flicker_result_t *result) {
+  bool ready = flicker->ready;
+  *result = flicker->result;
+  flicker->ready = false;
+  return ready;
+}
+
+} /* namespace als21c */
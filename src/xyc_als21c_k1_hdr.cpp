@@ -0,0 +1,106 @@
+/*!
+ *
+ * 	I2C Driver for NEWOPT XYC_ALS21C ambient light sensor
+ *
+ * 	This is a library for the NEWOPT XYC_ALS21C breakout:
+ * 	http://oshwlab.com/koendv/xyc_als21c_k1
+ *
+ *      HDR: a sensitive and an insensitive configuration, measured in turn.
+ *      each reading is merged with the last reading of the other configuration.
+ */
+
+#include <xyc_als21c_k1.h>
+
+namespace als21c {
+
+/*!
+ * @brief  initialize HDR. does not access the sensor.
+ * @param  gain_high, itime_high
+ *         sensitive configuration, for dark scenes. e.g. gain 512, itime 16
+ * @param  gain_low, itime_low
+ *         insensitive configuration, for bright scenes. e.g. gain 4, itime 16.
+ *         counts saturate at normalized count 1024 / gain; gain 4 or less reaches 110000 lux.
+ *         itime in units of 1.17 ms.
+ */
+void als21c_hdr_init(als21c_hdr_t *hdr, als21c_dev_t *dev, uint32_t gain_high, uint32_t itime_high, uint32_t gain_low, uint32_t itime_low) {
+  hdr->dev = dev;
+  hdr->gain[0] = gain_high;
+  hdr->itime[0] = itime_high;
+  hdr->gain[1] = gain_low;
+  hdr->itime[1] = itime_low;
+  hdr->phase = 0;
+  hdr->have = 0;
+}
+
+/* single measurement with configuration of this phase */
+static uint32_t als21c_hdr_measure(als21c_hdr_t *hdr) {
+  als21c_dev_t *dev = hdr->dev;
+  als21c_defer_writes(dev);
+  als21c_set_gain_value(dev, hdr->gain[hdr->phase]);
+  als21c_set_integration_time(dev, hdr->itime[hdr->phase]);
+  return als21c_start(dev, true);
+}
+
+/*!
+ * @brief  start HDR measurement, without waiting for the result
+ * @return deadline: time the first reading is ready, in microseconds of micros().
+ *         turns auto lux and wait time off.
+ *         each measurement is a single measurement (en_once), so every
+ *         sample has a known configuration and none is discarded.
+ */
+uint32_t als21c_hdr_start(als21c_hdr_t *hdr) {
+  als21c_dev_t *dev = hdr->dev;
+  als21c_defer_writes(dev);
+  als21c_set_auto_lux_mode(dev, ALS21C_AUTO_LUX_OFF);
+  als21c_set_wait_time_millisec(dev, 0);
+  hdr->phase = 0;
+  hdr->have = 0;
+  return als21c_hdr_measure(hdr);
+}
+
+/* weighted mean of the last reading of each configuration */
+static int32_t als21c_hdr_merge(als21c_hdr_t *hdr) {
+  uint32_t w0 = hdr->have & 1 ? hdr->weight[0] : 0;
+  uint32_t w1 = hdr->have & 2 ? hdr->weight[1] : 0;
+  if (w0 + w1 == 0) {
+    /* no count in range: dark, or saturated */
+    if ((hdr->have & 1) && hdr->lux[0] >= 0) return hdr->lux[0];
+    if ((hdr->have & 2) && hdr->lux[1] >= 0) return hdr->lux[1];
+    return hdr->lux[hdr->phase];
+  }
+  return ((int64_t)w0 * hdr->lux[0] + (int64_t)w1 * hdr->lux[1] + (w0 + w1) / 2) / (w0 + w1);
+}
+
+/*!
+ * @brief  non-blocking HDR step. does not touch the bus before the deadline.
+ * @param  now_us
+ *         current time, from micros()
+ * @return lux, or ALS21C_ERR_NOT_READY if there is no new reading, or an error.
+ *         a result after every reading, merged with the last reading of the
+ *         other configuration. The weight of a reading is count * headroom /
+ *         max count, with headroom = max count - count: small for counts
+ *         near zero, with few significant digits, and near saturation;
+ *         zero if saturated.
+ */
+int32_t als21c_hdr_poll(als21c_hdr_t *hdr, uint32_t now_us) {
+  als21c_dev_t *dev = hdr->dev;
+  uint8_t phase = hdr->phase;
+  int32_t lux = als21c_poll(dev, now_us);
+  if (lux == ALS21C_ERR_NOT_READY) return lux;
+
+  hdr->lux[phase] = lux;
+  hdr->weight[phase] = 0;
+  if (lux >= 0) {
+    uint32_t count = dev->data.als_data;
+    uint32_t max_count = als21c_get_max_count(dev);
+    if (count < max_count) hdr->weight[phase] = (uint64_t)count * (max_count - count) / max_count;
+  }
+  hdr->have |= 1 << phase;
+
+  /* next measurement with the other configuration */
+  hdr->phase = phase ^ 1;
+  als21c_hdr_measure(hdr);
+  return als21c_hdr_merge(hdr);
+}
+
+} /* namespace als21c */
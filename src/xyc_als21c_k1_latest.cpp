@@ -0,0 +1,117 @@
+/*!
+ *
+ * 	I2C Driver for NEWOPT XYC_ALS21C ambient light sensor
+ *
+ * 	This is a library for the NEWOPT XYC_ALS21C breakout:
+ * 	http://oshwlab.com/koendv/xyc_als21c_k1
+ *
+ *      latest reading, for multi-threaded hosts: one sampling task owns
+ *      the sensor, any number of threads read the latest reading.
+ */
+
+#include <cstring>
+#include <xyc_als21c_k1.h>
+
+/* 32-bit atomics; not on avr */
+#ifndef __AVR__
+
+namespace als21c {
+
+/*
+ * seqlock with two copies. the writer increments seq, writes copy 0,
+ * increments seq, writes copy 1. a reader takes copy seq & 1, the one not
+ * being written, and checks seq did not change meanwhile. a reader never
+ * waits for a writer that is preempted halfway, and never stores: readers
+ * do not slow down the sampling task, nor each other.
+ */
+
+#define ALS21C_LOAD_ACQUIRE(p) __atomic_load_n(p, __ATOMIC_ACQUIRE)
+
+/* the copy before, then seq + 1, then the copy after: release on both sides */
+static void als21c_latest_step(als21c_latest_t *latest, uint32_t seq) {
+  __atomic_store_n(&latest->seq, seq, __ATOMIC_RELEASE);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+/* copy a snapshot. lux is stored whole, als21c_latest_lux() reads it without seq */
+static void als21c_latest_copy(als21c_snapshot_t *to, const als21c_snapshot_t *from) {
+  to->t_us = from->t_us;
+  __atomic_store_n(&to->lux, from->lux, __ATOMIC_RELAXED);
+  to->count = from->count;
+  to->gain = from->gain;
+  to->itime = from->itime;
+  to->config_gen = from->config_gen;
+  to->flags = from->flags;
+}
+
+/*!
+ * @brief  initialize, without reading
+ */
+void als21c_latest_init(als21c_latest_t *latest) {
+  memset(latest, 0, sizeof(*latest));
+}
+
+/*!
+ * @brief  publish a reading. from one task only.
+ */
+void als21c_latest_publish(als21c_latest_t *latest, const als21c_snapshot_t *snapshot) {
+  uint32_t seq = latest->seq;
+  als21c_latest_step(latest, seq + 1);
+  als21c_latest_copy(&latest->snapshot[0], snapshot);
+  als21c_latest_step(latest, seq + 2);
+  als21c_latest_copy(&latest->snapshot[1], snapshot);
+}
+
+/*!
+ * @brief  sampling task: als21c_poll() and, if there is a reading, publish it.
+ *         the sampling task is the only one to touch dev. a sensor without
+ *         tracker gets the one of latest, see als21c_set_track().
+ * @return lux, or ALS21C_ERR_NOT_READY, or an error. see als21c_poll().
+ */
+int32_t als21c_latest_poll(als21c_latest_t *latest, als21c_dev_t *dev, uint32_t now_us) {
+  als21c_snapshot_t snapshot;
+  int32_t lux;
+  /* gain, integration time and flags of every reading */
+  if (dev->track == NULL) als21c_set_track(dev, &latest->track);
+  lux = als21c_poll(dev, now_us);
+  if (lux == ALS21C_ERR_NOT_READY) return lux;
+  snapshot.t_us = als21c_micros(dev);
+  snapshot.lux = lux;
+  snapshot.count = dev->data.als_data;
+  snapshot.gain = dev->track->gain;
+  snapshot.itime = dev->track->itime;
+  snapshot.config_gen = dev->config_gen;
+  snapshot.flags = dev->track->flags;
+  als21c_latest_publish(latest, &snapshot);
+  return lux;
+}
+
+/*!
+ * @brief  copy of the latest reading. any thread; no lock, no bus access.
+ * @return false if nothing published yet
+ */
+bool als21c_latest_read(const als21c_latest_t *latest, als21c_snapshot_t *snapshot) {
+  for (;;) {
+    uint32_t seq = ALS21C_LOAD_ACQUIRE(&latest->seq);
+    if (seq < 2) return false;
+    memcpy(snapshot, (const void *)&latest->snapshot[seq & 1], sizeof(*snapshot));
+    /* the copy before the second look at seq */
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if (__atomic_load_n(&latest->seq, __ATOMIC_RELAXED) == seq) return true;
+  }
+}
+
+/*!
+ * @brief  latest lux only. two loads, no retry.
+ * @return lux, or negative error. ALS21C_ERR_NOT_READY if nothing published yet
+ */
+int32_t als21c_latest_lux(const als21c_latest_t *latest) {
+  uint32_t seq = ALS21C_LOAD_ACQUIRE(&latest->seq);
+  if (seq < 2) return ALS21C_ERR_NOT_READY;
+  /* either copy holds a whole reading: the latest, or the one before */
+  return __atomic_load_n(&latest->snapshot[seq & 1].lux, __ATOMIC_RELAXED);
+}
+
+} /* namespace als21c */
+
+#endif
@@ -0,0 +1,128 @@
+/*!
+ *
+ * 	I2C Driver for NEWOPT XYC_ALS21C ambient light sensor
+ *
+ * 	This is a library for the NEWOPT XYC_ALS21C breakout:
+ * 	http://oshwlab.com/koendv/xyc_als21c_k1
+ *
+ *      code for linux i2c-dev
+ */
+
+#if defined(__linux__) && !defined(ARDUINO)
+
+#include <xyc_als21c_k1_linux.h>
+#include <cstdio>
+#include <fcntl.h>
+#include <linux/gpio.h>
+#include <unistd.h>
+
+namespace als21c {
+
+static als21c_linux_bus_t als21c_linux_default = { -1, false, 0, -1 };
+
+/*!
+ * @brief  open linux i2c-dev adapter
+ * @param  adapter
+ * @param  bus
+ *         initialized with adapter as bus handle
+ * @param  path
+ *         i2c-dev device, e.g. /dev/i2c-1
+ * @param  mux_addr
+ *         I2C address of TCA9548-style multiplexer, if any
+ * @return true if ok. if false, errno is in adapter->error
+ */
+bool als21c_linux_open(als21c_linux_bus_t *adapter, als21c_bus_t *bus, const char *path, uint8_t mux_addr) {
+  unsigned long funcs = 0;
+  adapter->rdwr = false;
+  adapter->error = 0;
+  adapter->slave = -1;
+  adapter->fd = open(path, O_RDWR | O_CLOEXEC);
+  if (adapter->fd < 0) {
+    adapter->error = errno;
+    return false;
+  }
+  if (ioctl(adapter->fd, I2C_FUNCS, &funcs) < 0) {
+    adapter->error = errno;
+    als21c_linux_close(adapter);
+    return false;
+  }
+  adapter->rdwr = funcs & I2C_FUNC_I2C;
+  if (!adapter->rdwr && !(funcs & I2C_FUNC_SMBUS_I2C_BLOCK)) {
+    adapter->error = EOPNOTSUPP;
+    als21c_linux_close(adapter);
+    return false;
+  }
+  if (bus != NULL) als21c_bus_init(bus, adapter, mux_addr);
+  return true;
+}
+
+/*!
+ * @brief  close linux i2c-dev adapter
+ */
+void als21c_linux_close(als21c_linux_bus_t *adapter) {
+  if (adapter->fd >= 0) close(adapter->fd);
+  adapter->fd = -1;
+  adapter->slave = -1;
+}
+
+/*!
+ * @brief  adapter used by sensors without bus handle, opened on first use
+ */
+als21c_linux_bus_t *als21c_linux_default_bus() {
+  if (als21c_linux_default.fd < 0)
+    als21c_linux_open(&als21c_linux_default, NULL, ALS21C_LINUX_DEFAULT_BUS, ALS21C_MUX_ADDR);
+  return &als21c_linux_default;
+}
+
+/*!
+ * @brief  request the gpio line of the INT pin, for edge events
+ * @param  chip
+ *         gpio chip, e.g. /dev/gpiochip0
+ * @param  line
+ *         line offset on the chip
+ * @return file descriptor, nonblocking, readable on a falling edge of INT; -1 on error, errno is set.
+ *         read struct gpio_v2_line_event from it to clear.
+ */
+int als21c_linux_gpio_open(const char *chip, unsigned line) {
+  struct gpio_v2_line_request req;
+  int fd = open(chip, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) return -1;
+  memset(&req, 0, sizeof(req));
+  req.offsets[0] = line;
+  req.num_lines = 1;
+  /* INT is open drain, active low */
+  req.config.flags = GPIO_V2_LINE_FLAG_INPUT | GPIO_V2_LINE_FLAG_EDGE_FALLING;
+  strncpy(req.consumer, "als21c", sizeof(req.consumer) - 1);
+  if (ioctl(fd, GPIO_V2_GET_LINE_IOCTL, &req) < 0) {
+    int err = errno;
+    close(fd);
+    errno = err;
+    return -1;
+  }
+  close(fd);
+  fcntl(req.fd, F_SETFL, O_NONBLOCK);
+  return req.fd;
+}
+
+#ifndef ALS21C_SIM
+
+void als21c_dump_regs(als21c_dev_t *dev) {
+  printf("reg_sysm_ctrl %X\n", als21c_i2c_read8(dev, ALS21C_REG_SYSM_CTRL));
+  printf("reg_int_ctrl %X\n", als21c_i2c_read8(dev, ALS21C_REG_INT_CTRL));
+  printf("reg_int_flag %X\n", als21c_i2c_read8(dev, ALS21C_REG_INT_FLAG));
+  printf("reg_wait_time %X\n", als21c_i2c_read8(dev, ALS21C_REG_WAIT_TIME));
+  printf("reg_als_gain %X\n", als21c_i2c_read8(dev, ALS21C_REG_ALS_GAIN));
+  printf("reg_als_time %X\n", als21c_i2c_read8(dev, ALS21C_REG_ALS_TIME));
+  printf("reg_persistence %X\n", als21c_i2c_read8(dev, ALS21C_REG_PERSISTENCE));
+  printf("reg_als_thres_l %X\n", als21c_i2c_read16(dev, ALS21C_REG_ALS_THRES_L));
+  printf("reg_als_thres_h %X\n", als21c_i2c_read16(dev, ALS21C_REG_ALS_THRES_H));
+  printf("reg_data_status %X\n", als21c_i2c_read8(dev, ALS21C_REG_DATA_STATUS));
+  printf("reg_als_data %X\n", als21c_i2c_read16(dev, ALS21C_REG_ALS_DATA));
+  printf("reg_prod_id %X\n", als21c_i2c_read16(dev, ALS21C_REG_PROD_ID));
+}
+
+#endif
+
+} /* namespace als21c */
+
+#endif
@@ -0,0 +1,163 @@
+/*!
+ *
+ * 	I2C Driver for NEWOPT XYC_ALS21C ambient light sensor
+ *
+ * 	This is a library for the NEWOPT XYC_ALS21C breakout:
+ * 	http://oshwlab.com/koendv/xyc_als21c_k1
+ *
+ *      code for linux i2c-dev
+ *      register reads are a single I2C_RDWR ioctl: register write, repeated start, read.
+ */
+
+#ifndef _XYC_ALS21C_K1_LINUX_H
+#define _XYC_ALS21C_K1_LINUX_H
+
+#include <xyc_als21c_k1.h>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <sys/ioctl.h>
+#include <linux/i2c.h>
+#include <linux/i2c-dev.h>
+
+namespace als21c {
+
+/* bus used by sensors without bus handle */
+#define ALS21C_LINUX_DEFAULT_BUS "/dev/i2c-1"
+
+/*!
+   linux i2c-dev adapter. Use as bus handle of als21c_bus_t.
+   fd: file descriptor of /dev/i2c-N, -1 if closed.
+   rdwr: adapter supports combined I2C_RDWR transfers. If not, SMBus
+         i2c block transfers are used, e.g. for the i2c-stub module.
+   error: errno of last failed transaction, 0 if none.
+   slave: address set with I2C_SLAVE for SMBus transfers, -1 if none.
+*/
+typedef struct {
+  int fd;
+  bool rdwr;
+  int error;
+  int slave;
+} als21c_linux_bus_t;
+
+bool als21c_linux_open(als21c_linux_bus_t *adapter, als21c_bus_t *bus, const char *path, uint8_t mux_addr);
+void als21c_linux_close(als21c_linux_bus_t *adapter);
+als21c_linux_bus_t *als21c_linux_default_bus(void);
+int als21c_linux_gpio_open(const char *chip, unsigned line);
+
+/*!
+   I2C transport for linux i2c-dev. Bus handle is an als21c_linux_bus_t *;
+   NULL is ALS21C_LINUX_DEFAULT_BUS.
+*/
+class als21c_linux_transport {
+public:
+  /* single I2C_RDWR ioctl with one or two messages */
+  static bool rdwr(als21c_linux_bus_t *adapter, struct i2c_msg *msgs, int nmsgs) {
+    struct i2c_rdwr_ioctl_data data;
+    data.msgs = msgs;
+    data.nmsgs = nmsgs;
+    if (ioctl(adapter->fd, I2C_RDWR, &data) != nmsgs) {
+      adapter->error = errno;
+      return false;
+    }
+    return true;
+  }
+
+  /* SMBus transfer, for adapters without I2C_RDWR. I2C_SLAVE only when the address changes */
+  static bool smbus(als21c_linux_bus_t *adapter, uint8_t addr, uint8_t read_write, uint8_t reg, int size, union i2c_smbus_data *data) {
+    struct i2c_smbus_ioctl_data args;
+    if (adapter->slave != addr) {
+      if (ioctl(adapter->fd, I2C_SLAVE, addr) < 0) {
+        adapter->error = errno;
+        adapter->slave = -1;
+        return false;
+      }
+      adapter->slave = addr;
+    }
+    args.read_write = read_write;
+    args.command = reg;
+    args.size = size;
+    args.data = data;
+    if (ioctl(adapter->fd, I2C_SMBUS, &args) < 0) {
+      adapter->error = errno;
+      return false;
+    }
+    return true;
+  }
+
+  /* select bus and multiplexer channel */
+  static als21c_linux_bus_t *select(als21c_dev_t *dev) {
+    als21c_bus_t *bus = dev->bus;
+    als21c_linux_bus_t *adapter;
+    if (bus != NULL && bus->handle != NULL) adapter = (als21c_linux_bus_t *)bus->handle;
+    else adapter = als21c_linux_default_bus();
+    if (bus != NULL && dev->mux_channel != ALS21C_MUX_NONE && bus->mux_channel != dev->mux_channel) {
+      uint8_t ctrl = uint8_t(1 << dev->mux_channel);
+      bool ok;
+      dev->transactions++;
+      if (adapter->rdwr) {
+        struct i2c_msg msg = { bus->mux_addr, 0, 1, &ctrl };
+        ok = rdwr(adapter, &msg, 1);
+      } else {
+        ok = smbus(adapter, bus->mux_addr, I2C_SMBUS_WRITE, ctrl, I2C_SMBUS_BYTE, NULL);
+      }
+      if (ok) {
+        bus->mux_channel = dev->mux_channel;
+      } else {
+        bus->mux_channel = ALS21C_MUX_NONE;
+        dev->errors++;
+      }
+    }
+    return adapter;
+  }
+
+  static bool read(als21c_dev_t *dev, const uint8_t reg, uint8_t *data, const uint8_t len) {
+    als21c_linux_bus_t *adapter = select(dev);
+    if (adapter->fd < 0) return false;
+    if (adapter->rdwr) {
+      /* register address write, repeated start, read */
+      uint8_t addr_buf = reg;
+      struct i2c_msg msgs[2] = {
+        { dev->addr, 0, 1, &addr_buf },
+        { dev->addr, I2C_M_RD, len, data },
+      };
+      return rdwr(adapter, msgs, 2);
+    }
+    if (len > I2C_SMBUS_BLOCK_MAX) return false;
+    union i2c_smbus_data blk;
+    blk.block[0] = len;
+    if (!smbus(adapter, dev->addr, I2C_SMBUS_READ, reg, I2C_SMBUS_I2C_BLOCK_DATA, &blk)) return false;
+    memcpy(data, &blk.block[1], len);
+    return true;
+  }
+
+  static bool write(als21c_dev_t *dev, const uint8_t reg, const uint8_t *data, const uint8_t len) {
+    als21c_linux_bus_t *adapter = select(dev);
+    if (adapter->fd < 0 || len > I2C_SMBUS_BLOCK_MAX) return false;
+    if (adapter->rdwr) {
+      uint8_t buf[I2C_SMBUS_BLOCK_MAX + 1];
+      buf[0] = reg;
+      memcpy(&buf[1], data, len);
+      struct i2c_msg msg = { dev->addr, 0, uint16_t(len + 1), buf };
+      return rdwr(adapter, &msg, 1);
+    }
+    union i2c_smbus_data blk;
+    blk.block[0] = len;
+    memcpy(&blk.block[1], data, len);
+    return smbus(adapter, dev->addr, I2C_SMBUS_WRITE, reg, I2C_SMBUS_I2C_BLOCK_DATA, &blk);
+  }
+
+  /* clock, microseconds. wraps around. */
+  static uint32_t micros(als21c_dev_t *) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return uint32_t(ts.tv_sec) * 1000000u + uint32_t(ts.tv_nsec / 1000);
+  }
+
+  /* resolution of micros(); allows for scheduling delay */
+  static const uint32_t clock_res_us = 100;
+};
+
+} /* namespace als21c */
+
+#endif
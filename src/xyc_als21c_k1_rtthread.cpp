@@ -0,0 +1,48 @@
+/*!
+ *
+ * 	I2C Driver for NEWOPT XYC_ALS21C ambient light sensor
+ *
+ * 	This is a library for the NEWOPT XYC_ALS21C breakout:
+ * 	http://oshwlab.com/koendv/xyc_als21c_k1
+ *
+ *      code for rt-thread
+ */
+
+#if defined(__RTTHREAD__) && !defined(ARDUINO)
+
+#include <xyc_als21c_k1_rtthread.h>
+
+namespace als21c {
+
+/*!
+ * @brief  i2c bus used by sensors without bus handle, found on first use
+ */
+struct rt_i2c_bus_device *als21c_rtthread_default_bus() {
+  static struct rt_i2c_bus_device *i2c = RT_NULL;
+  if (i2c == RT_NULL)
+    i2c = (struct rt_i2c_bus_device *)rt_device_find(ALS21C_RTTHREAD_DEFAULT_BUS);
+  return i2c;
+}
+
+#ifndef ALS21C_SIM
+
+void als21c_dump_regs(als21c_dev_t *dev) {
+  rt_kprintf("reg_sysm_ctrl %X\n", als21c_i2c_read8(dev, ALS21C_REG_SYSM_CTRL));
+  rt_kprintf("reg_int_ctrl %X\n", als21c_i2c_read8(dev, ALS21C_REG_INT_CTRL));
+  rt_kprintf("reg_int_flag %X\n", als21c_i2c_read8(dev, ALS21C_REG_INT_FLAG));
+  rt_kprintf("reg_wait_time %X\n", als21c_i2c_read8(dev, ALS21C_REG_WAIT_TIME));
+  rt_kprintf("reg_als_gain %X\n", als21c_i2c_read8(dev, ALS21C_REG_ALS_GAIN));
+  rt_kprintf("reg_als_time %X\n", als21c_i2c_read8(dev, ALS21C_REG_ALS_TIME));
+  rt_kprintf("reg_persistence %X\n", als21c_i2c_read8(dev, ALS21C_REG_PERSISTENCE));
+  rt_kprintf("reg_als_thres_l %X\n", als21c_i2c_read16(dev, ALS21C_REG_ALS_THRES_L));
+  rt_kprintf("reg_als_thres_h %X\n", als21c_i2c_read16(dev, ALS21C_REG_ALS_THRES_H));
+  rt_kprintf("reg_data_status %X\n", als21c_i2c_read8(dev, ALS21C_REG_DATA_STATUS));
+  rt_kprintf("reg_als_data %X\n", als21c_i2c_read16(dev, ALS21C_REG_ALS_DATA));
+  rt_kprintf("reg_prod_id %X\n", als21c_i2c_read16(dev, ALS21C_REG_PROD_ID));
+}
+
+#endif
+
+} /* namespace als21c */
+
+#endif
@@ -0,0 +1,99 @@
+/*!
+ *
+ * 	I2C Driver for NEWOPT XYC_ALS21C ambient light sensor
+ *
+ * 	This is a library for the NEWOPT XYC_ALS21C breakout:
+ * 	http://oshwlab.com/koendv/xyc_als21c_k1
+ *
+ *      I2C transport for rt-thread
+ */
+
+#ifndef _XYC_ALS21C_K1_RTTHREAD_H
+#define _XYC_ALS21C_K1_RTTHREAD_H
+
+#include <xyc_als21c_k1.h>
+#include <rtthread.h>
+#include <rtdevice.h>
+
+namespace als21c {
+
+/* bus used by sensors without bus handle */
+#ifndef ALS21C_RTTHREAD_DEFAULT_BUS
+#define ALS21C_RTTHREAD_DEFAULT_BUS "i2c1"
+#endif
+
+struct rt_i2c_bus_device *als21c_rtthread_default_bus(void);
+
+/*!
+   I2C transport for rt-thread. Bus handle is a struct rt_i2c_bus_device *;
+   NULL is ALS21C_RTTHREAD_DEFAULT_BUS.
+*/
+class als21c_rtthread_transport {
+public:
+  /* select bus and multiplexer channel */
+  static struct rt_i2c_bus_device *select(als21c_dev_t *dev) {
+    als21c_bus_t *bus = dev->bus;
+    struct rt_i2c_bus_device *i2c;
+    if (bus != NULL && bus->handle != NULL) i2c = (struct rt_i2c_bus_device *)bus->handle;
+    else i2c = als21c_rtthread_default_bus();
+    if (i2c != NULL && bus != NULL && dev->mux_channel != ALS21C_MUX_NONE && bus->mux_channel != dev->mux_channel) {
+      rt_uint8_t ctrl = rt_uint8_t(1 << dev->mux_channel);
+      struct rt_i2c_msg msg;
+      msg.addr = bus->mux_addr;
+      msg.flags = RT_I2C_WR;
+      msg.len = 1;
+      msg.buf = &ctrl;
+      dev->transactions++;
+      if (rt_i2c_transfer(i2c, &msg, 1) == 1) {
+        bus->mux_channel = dev->mux_channel;
+      } else {
+        bus->mux_channel = ALS21C_MUX_NONE;
+        dev->errors++;
+      }
+    }
+    return i2c;
+  }
+
+  static bool read(als21c_dev_t *dev, const uint8_t reg, uint8_t *data, const uint8_t len) {
+    struct rt_i2c_bus_device *i2c = select(dev);
+    rt_uint8_t addr_buf = reg;
+    struct rt_i2c_msg msgs[2];
+    if (i2c == NULL) return false;
+    /* register address write, repeated start, read */
+    msgs[0].addr = dev->addr;
+    msgs[0].flags = RT_I2C_WR;
+    msgs[0].len = 1;
+    msgs[0].buf = &addr_buf;
+    msgs[1].addr = dev->addr;
+    msgs[1].flags = RT_I2C_RD;
+    msgs[1].len = len;
+    msgs[1].buf = data;
+    return rt_i2c_transfer(i2c, msgs, 2) == 2;
+  }
+
+  static bool write(als21c_dev_t *dev, const uint8_t reg, const uint8_t *data, const uint8_t len) {
+    struct rt_i2c_bus_device *i2c = select(dev);
+    rt_uint8_t buf[16];
+    struct rt_i2c_msg msg;
+    if (i2c == NULL || len > sizeof(buf) - 1) return false;
+    buf[0] = reg;
+    rt_memcpy(&buf[1], data, len);
+    msg.addr = dev->addr;
+    msg.flags = RT_I2C_WR;
+    msg.len = len + 1;
+    msg.buf = buf;
+    return rt_i2c_transfer(i2c, &msg, 1) == 1;
+  }
+
+  /* clock, microseconds. wraps around. */
+  static uint32_t micros(als21c_dev_t *) {
+    return uint32_t(rt_tick_get()) * (1000000u / RT_TICK_PER_SECOND);
+  }
+
+  /* resolution of micros(): one tick */
+  static const uint32_t clock_res_us = 1000000u / RT_TICK_PER_SECOND;
+};
+
+} /* namespace als21c */
+
+#endif
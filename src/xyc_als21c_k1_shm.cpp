@@ -0,0 +1,211 @@
+/*!
+ *
+ * 	I2C Driver for NEWOPT XYC_ALS21C ambient light sensor
+ *
+ * 	This is a library for the NEWOPT XYC_ALS21C breakout:
+ * 	http://oshwlab.com/koendv/xyc_als21c_k1
+ *
+ *      linux: shared memory sample ring.
+ */
+
+#if defined(__linux__) && !defined(ARDUINO)
+
+#include <xyc_als21c_k1_shm.h>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace als21c {
+
+/*
+ * one writer, any number of readers, no locks.
+ * the writer marks a slot odd, writes the sample, marks the slot even with
+ * the sample number, then publishes head. a reader copies the sample and
+ * checks the slot did not change meanwhile; else the writer lapped it.
+ * readers never write to the shared memory; a reader that falls behind
+ * cannot hold up the writer, it loses samples.
+ */
+
+#define ALS21C_LOAD_ACQUIRE(p) __atomic_load_n(p, __ATOMIC_ACQUIRE)
+#define ALS21C_STORE_RELEASE(p, v) __atomic_store_n(p, v, __ATOMIC_RELEASE)
+
+/*!
+ * @brief  create the shared memory file and map it. replaces an old file; readers of the old file keep it until they detach.
+ * @param  path
+ *         file, NULL is ALS21C_SHM_PATH
+ * @param  slots
+ *         samples kept, rounded up to a power of two
+ * @return false on error; errno is set
+ */
+bool als21c_shm_create(als21c_shm_t *shm, const char *path, uint32_t slots) {
+  uint32_t n = 1;
+  int fd;
+  void *p;
+
+  if (path == NULL) path = ALS21C_SHM_PATH;
+  while (n < slots && n < 0x80000000u) n <<= 1;
+  strncpy(shm->path, path, sizeof(shm->path) - 1);
+  shm->path[sizeof(shm->path) - 1] = '\0';
+  shm->size = sizeof(als21c_shm_header_t) + n * sizeof(als21c_shm_slot_t);
+
+  /* a new file: a reader that mapped the old one must not see it shrink */
+  unlink(shm->path);
+  fd = open(shm->path, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+  if (fd < 0) return false;
+  if (ftruncate(fd, shm->size) < 0) {
+    close(fd);
+    unlink(shm->path);
+    return false;
+  }
+  p = mmap(NULL, shm->size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (p == MAP_FAILED) {
+    unlink(shm->path);
+    return false;
+  }
+
+  /* the file is zero: all slots empty. magic last, once the header is complete */
+  shm->hdr = (als21c_shm_header_t *)p;
+  shm->slot = (als21c_shm_slot_t *)(shm->hdr + 1);
+  shm->hdr->version = ALS21C_SHM_VERSION;
+  shm->hdr->slot_size = sizeof(als21c_shm_slot_t);
+  shm->hdr->slots = n;
+  shm->hdr->sensors = 0;
+  ALS21C_STORE_RELEASE(&shm->hdr->magic, ALS21C_SHM_MAGIC);
+  return true;
+}
+
+/*!
+ * @brief  describe a sensor, for the readers
+ * @param  sensor
+ *         index, als21c_shm_sample_t.sensor
+ * @param  bus
+ *         bus number, e.g. 1 for /dev/i2c-1
+ * @param  mux_channel
+ *         multiplexer channel, or ALS21C_MUX_NONE
+ */
+void als21c_shm_set_sensor(als21c_shm_t *shm, uint8_t sensor, uint8_t bus, int8_t mux_channel) {
+  shm->hdr->sensor[sensor].bus = bus;
+  shm->hdr->sensor[sensor].mux_channel = mux_channel;
+  if (sensor >= shm->hdr->sensors) ALS21C_STORE_RELEASE(&shm->hdr->sensors, (uint32_t)sensor + 1);
+}
+
+/*!
+ * @brief  publish a sample. overwrites the oldest. call from one thread only.
+ */
+void als21c_shm_publish(als21c_shm_t *shm, const als21c_shm_sample_t *sample) {
+  uint64_t n = shm->hdr->head;
+  als21c_shm_slot_t *slot = &shm->slot[n & (shm->hdr->slots - 1)];
+
+  __atomic_store_n(&slot->seq, 2 * n + 1, __ATOMIC_RELAXED);
+  /* odd before the sample */
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  slot->sample = *sample;
+  ALS21C_STORE_RELEASE(&slot->seq, 2 * n + 2);
+  ALS21C_STORE_RELEASE(&shm->hdr->head, n + 1);
+}
+
+/*!
+ * @brief  unmap and remove the file. readers keep what they mapped; new readers cannot attach.
+ */
+void als21c_shm_close(als21c_shm_t *shm) {
+  if (shm->hdr == NULL) return;
+  munmap(shm->hdr, shm->size);
+  unlink(shm->path);
+  shm->hdr = NULL;
+}
+
+/*!
+ * @brief  map the file of a daemon, read-only. the first sample read is the next one published.
+ * @param  path
+ *         file, NULL is ALS21C_SHM_PATH
+ * @return false if there is no file, or not one of ours; errno is set
+ */
+bool als21c_shm_attach(als21c_shm_reader_t *reader, const char *path) {
+  struct stat st;
+  const als21c_shm_header_t *hdr;
+  int fd;
+  void *p;
+
+  if (path == NULL) path = ALS21C_SHM_PATH;
+  fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) return false;
+  if (fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(als21c_shm_header_t)) {
+    close(fd);
+    errno = EINVAL;
+    return false;
+  }
+  p = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (p == MAP_FAILED) return false;
+
+  hdr = (const als21c_shm_header_t *)p;
+  if (ALS21C_LOAD_ACQUIRE(&hdr->magic) != ALS21C_SHM_MAGIC || hdr->version != ALS21C_SHM_VERSION ||
+      hdr->slot_size != sizeof(als21c_shm_slot_t) ||
+      sizeof(als21c_shm_header_t) + (size_t)hdr->slots * sizeof(als21c_shm_slot_t) > (size_t)st.st_size) {
+    munmap(p, st.st_size);
+    errno = EINVAL;
+    return false;
+  }
+  reader->hdr = hdr;
+  reader->slot = (const als21c_shm_slot_t *)(hdr + 1);
+  reader->size = st.st_size;
+  reader->next = ALS21C_LOAD_ACQUIRE(&hdr->head);
+  reader->lost = 0;
+  return true;
+}
+
+/*!
+ * @brief  read the next sample. no system call.
+ *         a reader that fell more than a ring behind skips to the oldest sample
+ *         still there, and adds the samples skipped to lost.
+ * @return false if there is no new sample
+ */
+bool als21c_shm_read(als21c_shm_reader_t *reader, als21c_shm_sample_t *sample) {
+  uint32_t slots = reader->hdr->slots;
+  for (;;) {
+    uint64_t head = ALS21C_LOAD_ACQUIRE(&reader->hdr->head);
+    uint64_t n = reader->next;
+    const als21c_shm_slot_t *slot;
+    uint64_t seq;
+
+    if (n == head) return false;
+    if (head - n > slots) {
+      /* lapped; one slot spare, the writer may be in it */
+      reader->lost += head - slots + 1 - n;
+      n = reader->next = head - slots + 1;
+    }
+    slot = &reader->slot[n & (slots - 1)];
+    seq = ALS21C_LOAD_ACQUIRE(&slot->seq);
+    if (seq == 2 * n + 2) {
+      memcpy(sample, (const void *)&slot->sample, sizeof(*sample));
+      /* the copy before the second look at seq */
+      __atomic_thread_fence(__ATOMIC_ACQUIRE);
+      seq = __atomic_load_n(&slot->seq, __ATOMIC_RELAXED);
+      if (seq == 2 * n + 2) {
+        reader->next = n + 1;
+        return true;
+      }
+    }
+    /* overwritten: the slot holds sample (seq - 1) / 2, at least a ring ahead. skip to the oldest the writer is not in */
+    n = (seq - 1) / 2 + 2 - slots;
+    reader->lost += n - reader->next;
+    reader->next = n;
+  }
+}
+
+/*!
+ * @brief  unmap the file
+ */
+void als21c_shm_detach(als21c_shm_reader_t *reader) {
+  if (reader->hdr == NULL) return;
+  munmap((void *)reader->hdr, reader->size);
+  reader->hdr = NULL;
+}
+
+} /* namespace als21c */
+
+#endif
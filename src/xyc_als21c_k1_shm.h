@@ -0,0 +1,103 @@
+/*!
+ *
+ * 	I2C Driver for NEWOPT XYC_ALS21C ambient light sensor
+ *
+ * 	This is a library for the NEWOPT XYC_ALS21C breakout:
+ * 	http://oshwlab.com/koendv/xyc_als21c_k1
+ *
+ *      linux: shared memory sample ring. one daemon owns the sensors and
+ *      publishes every sample in a memory-mapped file; any number of local
+ *      processes map the file read-only and read the samples, without
+ *      system calls and without touching the bus.
+ */
+
+#ifndef _XYC_ALS21C_K1_SHM_H
+#define _XYC_ALS21C_K1_SHM_H
+
+#include <xyc_als21c_k1.h>
+#include <stddef.h>
+
+namespace als21c {
+
+/* default file; /dev/shm is memory, not disk */
+#ifndef ALS21C_SHM_PATH
+#define ALS21C_SHM_PATH "/dev/shm/als21c"
+#endif
+
+/* most sensors in the sensor table */
+#define ALS21C_SHM_SENSORS 256
+
+#define ALS21C_SHM_MAGIC 0x43314c41 /* "AL1C" */
+#define ALS21C_SHM_VERSION 1
+
+/*! one sample, as published */
+typedef struct {
+  uint64_t t_us;  /* time of read, CLOCK_MONOTONIC, microseconds */
+  int32_t lux;    /* lux, or negative error */
+  uint16_t count; /* ALS count */
+  uint16_t gain;  /* gain, 1 to 512 */
+  uint16_t itime; /* integration time, units of 1.17 ms */
+  uint8_t sensor; /* index in the sensor table */
+  uint8_t flags;  /* ALS21C_FLAG_* */
+} als21c_shm_sample_t;
+
+/*!
+   slot of the ring. seq is a seqlock with the sample number in it:
+   2n + 1 while sample n is written, 2n + 2 once written.
+*/
+typedef struct {
+  uint64_t seq;
+  als21c_shm_sample_t sample;
+} als21c_shm_slot_t;
+
+/*!
+   start of the file. the slots follow.
+   slots: number of slots, power of two.
+   sensor: bus and multiplexer channel of each sensor, set by the daemon.
+   head: number of samples published. only written by the daemon; on a cache line of its own.
+*/
+typedef struct {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t slot_size;
+  uint32_t slots;
+  uint32_t sensors;
+  struct {
+    uint8_t bus;
+    int8_t mux_channel;
+  } sensor[ALS21C_SHM_SENSORS];
+  alignas(64) uint64_t head;
+} als21c_shm_header_t;
+
+/*! publisher side, the daemon */
+typedef struct {
+  als21c_shm_header_t *hdr;
+  als21c_shm_slot_t *slot;
+  size_t size;
+  char path[64];
+} als21c_shm_t;
+
+/*!
+   reader side. one per reading thread.
+   next: number of the next sample to read.
+   lost: samples overwritten before they were read.
+*/
+typedef struct {
+  const als21c_shm_header_t *hdr;
+  const als21c_shm_slot_t *slot;
+  size_t size;
+  uint64_t next;
+  uint64_t lost;
+} als21c_shm_reader_t;
+
+bool als21c_shm_create(als21c_shm_t *shm, const char *path, uint32_t slots);
+void als21c_shm_set_sensor(als21c_shm_t *shm, uint8_t sensor, uint8_t bus, int8_t mux_channel);
+void als21c_shm_publish(als21c_shm_t *shm, const als21c_shm_sample_t *sample);
+void als21c_shm_close(als21c_shm_t *shm);
+bool als21c_shm_attach(als21c_shm_reader_t *reader, const char *path);
+bool als21c_shm_read(als21c_shm_reader_t *reader, als21c_shm_sample_t *sample);
+void als21c_shm_detach(als21c_shm_reader_t *reader);
+
+} /* namespace als21c */
+
+#endif
@@ -0,0 +1,482 @@
+/*!
+ *
+ * 	I2C Driver for NEWOPT XYC_ALS21C ambient light sensor
+ *
+ * 	This is a library for the NEWOPT XYC_ALS21C breakout:
+ * 	http://oshwlab.com/koendv/xyc_als21c_k1
+ *
+ *      software model of the sensor, for host builds without hardware.
+ *      compile with -DALS21C_SIM to use the model as I2C backend.
+ */
+
+#ifndef ARDUINO
+
+#include <xyc_als21c_k1_sim.h>
+#include <cstdio>
+#include <cstring>
+
+namespace als21c {
+
+als21c_sim::als21c_sim() {
+  lux_const = 0;
+  trace = NULL;
+  trace_len = 0;
+  trace_repeat = false;
+  light_fn = NULL;
+  light_ctx = NULL;
+  clock_ppm = 0;
+  power_on(0);
+}
+
+/*!
+ * @brief  power-on reset. registers to default values.
+ */
+void als21c_sim::power_on(uint64_t now_us) {
+  (void)now_us;
+  memset(regs, 0, sizeof(regs));
+  regs[ALS21C_REG_INT_CTRL] = 0x01;
+  regs[ALS21C_REG_INT_FLAG] = 0x80; /* int_por */
+  regs[ALS21C_REG_ALS_GAIN] = 0x01;
+  regs[ALS21C_REG_ALS_TIME] = 0x03;
+  regs[ALS21C_REG_PERSISTENCE] = 0x01;
+  regs[ALS21C_REG_ALS_THRES_L] = 0x00;
+  regs[ALS21C_REG_ALS_THRES_L + 1] = 0x00;
+  regs[ALS21C_REG_ALS_THRES_H] = 0xff;
+  regs[ALS21C_REG_ALS_THRES_H + 1] = 0xff;
+  regs[ALS21C_REG_PROD_ID] = ALS21C_PRODUCT_ID & 0xff;
+  regs[ALS21C_REG_PROD_ID + 1] = ALS21C_PRODUCT_ID >> 8;
+  state = IDLE;
+  t_start = t_end = 0;
+  gain = 1;
+  itime = 64;
+  pers_count = 0;
+  conversions = 0;
+}
+
+/*!
+ * @brief  constant light intensity
+ */
+void als21c_sim::set_lux(float lux) {
+  lux_const = lux;
+  trace = NULL;
+  light_fn = NULL;
+}
+
+/*!
+ * @brief  light intensity from a list of (time, lux) points
+ * @param  trace
+ *         points in increasing time. lux is interpolated linearly between points.
+ * @param  repeat
+ *         if true, trace repeats with period equal to time of last point
+ */
+void als21c_sim::set_trace(const als21c_sim_point_t *tr, size_t len, bool repeat) {
+  trace = tr;
+  trace_len = len;
+  trace_repeat = repeat && len > 1 && tr[len - 1].t_us > 0;
+  light_fn = NULL;
+}
+
+/*!
+ * @brief  light intensity from a function of time
+ */
+void als21c_sim::set_light(als21c_sim_light_fn fn, void *ctx) {
+  light_fn = fn;
+  light_ctx = ctx;
+  trace = NULL;
+}
+
+/*!
+ * @brief  light intensity at time t_us
+ */
+float als21c_sim::lux_at(uint64_t t_us) const {
+  if (light_fn) return light_fn(light_ctx, t_us);
+  if (trace == NULL || trace_len == 0) return lux_const;
+  if (trace_repeat) t_us %= trace[trace_len - 1].t_us;
+  if (t_us <= trace[0].t_us) return trace[0].lux;
+  for (size_t i = 1; i < trace_len; i++) {
+    if (t_us < trace[i].t_us) {
+      const als21c_sim_point_t &a = trace[i - 1], &b = trace[i];
+      return a.lux + (b.lux - a.lux) * (double)(t_us - a.t_us) / (double)(b.t_us - a.t_us);
+    }
+  }
+  return trace[trace_len - 1].lux;
+}
+
+/* integral of lux from time 0 to t_us, in lux * microseconds */
+double als21c_sim::trace_integral(uint64_t t_us) const {
+  double sum = 0;
+  if (trace_repeat) {
+    uint64_t period = trace[trace_len - 1].t_us;
+    sum = (double)(t_us / period) * trace_integral_once(period);
+    t_us %= period;
+  }
+  return sum + trace_integral_once(t_us);
+}
+
+/* integral of lux from time 0 to t_us, trace not repeated */
+double als21c_sim::trace_integral_once(uint64_t t_us) const {
+  double sum = 0;
+  uint64_t t = 0;
+  float lux = trace[0].lux;
+  for (size_t i = 0; i < trace_len && t < t_us; i++) {
+    const als21c_sim_point_t &p = trace[i];
+    uint64_t t1 = p.t_us < t_us ? p.t_us : t_us;
+    if (t1 > t) {
+      /* trapezoid from (t, lux) to (t1, lux at t1) */
+      float lux1 = lux + (p.lux - lux) * (double)(t1 - t) / (double)(p.t_us - t);
+      sum += 0.5 * (lux + lux1) * (t1 - t);
+      t = t1;
+      lux = lux1;
+    }
+    if (t == p.t_us) lux = p.lux;
+  }
+  if (t < t_us) sum += (double)lux * (t_us - t);
+  return sum;
+}
+
+/* mean light intensity between t0 and t1 */
+double als21c_sim::mean_lux(uint64_t t0, uint64_t t1) const {
+  if (t1 <= t0) return lux_at(t0);
+  if (light_fn) {
+    /* midpoint rule */
+    const int n = 32;
+    double sum = 0;
+    for (int i = 0; i < n; i++)
+      sum += light_fn(light_ctx, t0 + ((2 * i + 1) * (t1 - t0)) / (2 * n));
+    return sum / n;
+  }
+  if (trace == NULL || trace_len == 0) return lux_const;
+  return (trace_integral(t1) - trace_integral(t0)) / (double)(t1 - t0);
+}
+
+/*!
+ * @brief  convert lux to normalized count x = count / (gain * itime)
+ *         inverse of the calibration polynomial of the driver, by bisection.
+ *         above 110000 lux, extrapolated linearly.
+ */
+double als21c_sim::lux_to_x(double lux) {
+  if (lux <= 0) return 0;
+  double max_lux = als21c_cal_lux(ALS21C_SIM_MAX_X);
+  if (lux >= max_lux) {
+    double slope = (max_lux - als21c_cal_lux(ALS21C_SIM_MAX_X - 1.0));
+    return ALS21C_SIM_MAX_X + (lux - max_lux) / slope;
+  }
+  double lo = 0, hi = ALS21C_SIM_MAX_X;
+  for (int i = 0; i < 48; i++) {
+    double mid = 0.5 * (lo + hi);
+    if (als21c_cal_lux(mid) < lux) lo = mid;
+    else hi = mid;
+  }
+  return 0.5 * (lo + hi);
+}
+
+/* duration us of the sensor clock, in real time */
+uint64_t als21c_sim::sensor_us(uint64_t us) const {
+  return (us * (1000000 + clock_ppm) + 500000) / 1000000;
+}
+
+/* sensor measuring, continuous or single shot */
+bool als21c_sim::running() const {
+  return regs[ALS21C_REG_SYSM_CTRL] & 0x03;
+}
+
+void als21c_sim::start_integration(uint64_t t_us) {
+  uint8_t als_gain = regs[ALS21C_REG_ALS_GAIN];
+  uint8_t als_time = regs[ALS21C_REG_ALS_TIME];
+  /* als_sync: wait until interrupt cleared */
+  if ((regs[ALS21C_REG_INT_CTRL] & 0x10) && (regs[ALS21C_REG_INT_FLAG] & 0x01)) {
+    state = SYNC_WAIT;
+    return;
+  }
+  switch (als_gain & 0x1f) {
+    case ALS21C_GAIN_1X: gain = 1; break;
+    case ALS21C_GAIN_4X: gain = 4; break;
+    case ALS21C_GAIN_16X: gain = 16; break;
+    case ALS21C_GAIN_64X: gain = 64; break;
+    case ALS21C_GAIN_256X: gain = 256; break;
+    default: gain = 1; break;
+  }
+  if (als_gain & 0x80) gain *= 2;
+  itime = (1u << (2 * (als_time & 0x03))) * ((als_time >> 4) + 1);
+  t_start = t_us;
+  t_end = t_us + sensor_us((uint64_t)itime * ALS21C_SIM_T_US);
+  state = INTEGRATING;
+}
+
+void als21c_sim::end_integration() {
+  uint8_t status = 0;
+  double x = lux_to_x(mean_lux(t_start, t_end));
+  double rate = x * gain; /* counts per integration time unit */
+  uint32_t max_count = 1024 * itime - 1;
+  uint32_t count;
+
+  if (x > ALS21C_SIM_MAX_X) status |= 0x02; /* saturation_als */
+  if (rate >= 1024) {
+    status |= 0x01; /* saturation_comp */
+    count = max_count;
+  } else {
+    count = (uint32_t)(rate * itime);
+  }
+  if (count > 0xffff) count = 0xffff; /* digital overflow */
+
+  regs[ALS21C_REG_ALS_DATA] = count & 0xff;
+  regs[ALS21C_REG_ALS_DATA + 1] = count >> 8;
+  regs[ALS21C_REG_DATA_STATUS] = 0x80 | status;
+  regs[ALS21C_REG_INT_FLAG] |= 0x40; /* data_flag */
+  conversions++;
+
+  /* threshold and persistence */
+  if (regs[ALS21C_REG_INT_CTRL] & 0x01) {
+    uint8_t prs = regs[ALS21C_REG_PERSISTENCE] & 0x0f;
+    uint16_t thres_l = regs[ALS21C_REG_ALS_THRES_L] | regs[ALS21C_REG_ALS_THRES_L + 1] << 8;
+    uint16_t thres_h = regs[ALS21C_REG_ALS_THRES_H] | regs[ALS21C_REG_ALS_THRES_H + 1] << 8;
+    if (prs == 0) {
+      regs[ALS21C_REG_INT_FLAG] |= 0x01;
+    } else if (count < thres_l || count > thres_h) {
+      if (pers_count < prs) pers_count++;
+      if (pers_count >= prs) regs[ALS21C_REG_INT_FLAG] |= 0x01;
+    } else {
+      pers_count = 0;
+    }
+  }
+
+  /* single shot */
+  if (regs[ALS21C_REG_SYSM_CTRL] & 0x02) {
+    regs[ALS21C_REG_SYSM_CTRL] &= ~0x02;
+    if (!running()) {
+      state = IDLE;
+      return;
+    }
+  }
+
+  /* wait */
+  if (regs[ALS21C_REG_SYSM_CTRL] & 0x40) {
+    uint8_t wait_time = regs[ALS21C_REG_WAIT_TIME];
+    uint64_t wait_us = (uint64_t)(8u << (wait_time >> 6)) * ((wait_time & 0x3f) + 1) * 1000;
+    t_start = t_end;
+    t_end = t_end + sensor_us(wait_us);
+    state = WAITING;
+  } else {
+    start_integration(t_end);
+  }
+}
+
+/*!
+ * @brief  run the model up to time now_us
+ */
+void als21c_sim::advance(uint64_t now_us) {
+  while ((state == INTEGRATING || state == WAITING) && t_end <= now_us) {
+    if (state == INTEGRATING)
+      end_integration();
+    else
+      start_integration(t_end);
+  }
+}
+
+/*!
+ * @brief  time of next end of integration or end of wait, 0 if idle
+ */
+uint64_t als21c_sim::next_event() const {
+  if (state == INTEGRATING || state == WAITING) return t_end;
+  return 0;
+}
+
+/*!
+ * @brief  INT line. true if asserted.
+ */
+bool als21c_sim::interrupt() const {
+  return (regs[ALS21C_REG_INT_CTRL] & 0x01) && (regs[ALS21C_REG_INT_FLAG] & 0x81);
+}
+
+void als21c_sim::reg_write(uint8_t reg, uint8_t value, uint64_t now_us) {
+  switch (reg) {
+    case ALS21C_REG_SYSM_CTRL:
+      {
+        bool was_running = running();
+        if (value & 0x80) {
+          power_on(now_us);
+          return;
+        }
+        regs[reg] = value;
+        if (!was_running && running()) start_integration(now_us);
+        else if (was_running && !running()) state = IDLE;
+      }
+      break;
+    case ALS21C_REG_INT_FLAG:
+      /* writing 0 clears flag */
+      regs[reg] &= value;
+      if (state == SYNC_WAIT && !(regs[reg] & 0x01)) start_integration(now_us);
+      break;
+    case ALS21C_REG_DATA_STATUS:
+    case ALS21C_REG_ALS_DATA:
+    case ALS21C_REG_ALS_DATA + 1:
+    case ALS21C_REG_PROD_ID:
+    case ALS21C_REG_PROD_ID + 1:
+      break; /* read-only */
+    default:
+      regs[reg] = value;
+      break;
+  }
+}
+
+/*!
+ * @brief  register read with auto-increment, at time now_us
+ */
+void als21c_sim::read(uint64_t now_us, uint8_t reg, uint8_t *data, uint8_t len) {
+  advance(now_us);
+  for (uint8_t i = 0; i < len; i++)
+    data[i] = regs[uint8_t(reg + i)];
+  /* reading data status clears data_ready */
+  if (reg <= ALS21C_REG_DATA_STATUS && reg + len > ALS21C_REG_DATA_STATUS)
+    regs[ALS21C_REG_DATA_STATUS] &= ~0x80;
+}
+
+/*!
+ * @brief  register write with auto-increment, at time now_us
+ */
+void als21c_sim::write(uint64_t now_us, uint8_t reg, const uint8_t *data, uint8_t len) {
+  advance(now_us);
+  for (uint8_t i = 0; i < len; i++)
+    reg_write(uint8_t(reg + i), data[i], now_us);
+}
+
+als21c_sim_bus::als21c_sim_bus(als21c_sim *sensor) {
+  now_us = 0;
+  clock = &now_us;
+  now_fn = NULL;
+  wait_fn = NULL;
+  clock_ctx = NULL;
+  mux_addr = ALS21C_MUX_ADDR;
+  mux_ctrl = 0;
+  transactions = 0;
+  mux_writes = 0;
+  bus_hz = 0;
+  latency_us = 0;
+  busy_us = 0;
+  direct = sensor;
+  for (int i = 0; i < ALS21C_SIM_MUX_CHANNELS; i++)
+    channel[i] = NULL;
+}
+
+/*!
+ * @brief  attach simulated sensor to bus
+ * @param  mux_channel
+ *         multiplexer channel, ALS21C_MUX_NONE if not behind multiplexer
+ */
+void als21c_sim_bus::attach(als21c_sim *sensor, int8_t mux_channel) {
+  if (mux_channel == ALS21C_MUX_NONE) direct = sensor;
+  else if (mux_channel >= 0 && mux_channel < ALS21C_SIM_MUX_CHANNELS) channel[mux_channel] = sensor;
+}
+
+/*!
+ * @brief  use the clock of bus other.
+ *         for one program driving several buses, one transaction at a time.
+ *         sensors on this bus are run up to the clock when accessed, or by advance().
+ */
+void als21c_sim_bus::share_clock(als21c_sim_bus *other) {
+  clock = other->clock;
+}
+
+/*!
+ * @brief  use an external clock, e.g. real time, instead of the simulated clock.
+ *         advancing the clock waits; a transaction waits for its duration.
+ *         a bus with an external clock can be driven from its own thread.
+ */
+void als21c_sim_bus::set_clock(als21c_sim_now_fn now, als21c_sim_wait_fn wait, void *ctx) {
+  now_fn = now;
+  wait_fn = wait;
+  clock_ctx = ctx;
+}
+
+/*!
+ * @brief  advance simulated clock
+ */
+void als21c_sim_bus::advance(uint64_t us) {
+  advance_to(now() + us);
+}
+
+void als21c_sim_bus::advance_to(uint64_t t_us) {
+  uint64_t t;
+  if (now_fn)
+    wait_fn(clock_ctx, t_us);
+  else if (t_us > *clock)
+    *clock = t_us;
+  t = now();
+  if (direct) direct->advance(t);
+  for (int i = 0; i < ALS21C_SIM_MUX_CHANNELS; i++)
+    if (channel[i]) channel[i]->advance(t);
+}
+
+/* sensor that answers on addr */
+als21c_sim *als21c_sim_bus::selected(uint8_t addr) {
+  if (addr != ALS21C_I2C_ADDR) return NULL;
+  if (direct) return direct;
+  for (int i = 0; i < ALS21C_SIM_MUX_CHANNELS; i++)
+    if ((mux_ctrl & (1 << i)) && channel[i]) return channel[i];
+  return NULL;
+}
+
+/*
+ * time on the bus. bits: start, stop, and 9 clocks per byte, ack included.
+ * the sensor sees the transaction at its start.
+ */
+void als21c_sim_bus::transfer(uint32_t bits) {
+  uint64_t us = latency_us;
+  if (bus_hz != 0) us += ((uint64_t)bits * 1000000 + bus_hz - 1) / bus_hz;
+  if (us == 0) return;
+  busy_us += us;
+  advance(us);
+}
+
+/* start, address, register, repeated start, address, data, stop */
+bool als21c_sim_bus::read(uint8_t addr, uint8_t reg, uint8_t *data, uint8_t len) {
+  als21c_sim *sensor = selected(addr);
+  transactions++;
+  if (sensor != NULL) sensor->read(now(), reg, data, len);
+  transfer(3 + 9 * (3 + len));
+  return sensor != NULL; /* nack */
+}
+
+/* start, address, register, data, stop */
+bool als21c_sim_bus::write(uint8_t addr, uint8_t reg, const uint8_t *data, uint8_t len) {
+  als21c_sim *sensor = selected(addr);
+  transactions++;
+  if (sensor != NULL) sensor->write(now(), reg, data, len);
+  transfer(2 + 9 * (2 + len));
+  return sensor != NULL; /* nack */
+}
+
+bool als21c_sim_bus::write_mux(uint8_t addr, uint8_t ctrl) {
+  transactions++;
+  mux_writes++;
+  transfer(2 + 9 * 2);
+  if (addr != mux_addr) return false; /* nack */
+  mux_ctrl = ctrl;
+  return true;
+}
+
+als21c_sim als21c_sim_default;
+als21c_sim_bus als21c_sim_default_bus(&als21c_sim_default);
+
+#ifdef ALS21C_SIM
+
+void als21c_dump_regs(als21c_dev_t *dev) {
+  printf("reg_sysm_ctrl %X\n", als21c_i2c_read8(dev, ALS21C_REG_SYSM_CTRL));
+  printf("reg_int_ctrl %X\n", als21c_i2c_read8(dev, ALS21C_REG_INT_CTRL));
+  printf("reg_int_flag %X\n", als21c_i2c_read8(dev, ALS21C_REG_INT_FLAG));
+  printf("reg_wait_time %X\n", als21c_i2c_read8(dev, ALS21C_REG_WAIT_TIME));
+  printf("reg_als_gain %X\n", als21c_i2c_read8(dev, ALS21C_REG_ALS_GAIN));
+  printf("reg_als_time %X\n", als21c_i2c_read8(dev, ALS21C_REG_ALS_TIME));
+  printf("reg_persistence %X\n", als21c_i2c_read8(dev, ALS21C_REG_PERSISTENCE));
+  printf("reg_als_thres_l %X\n", als21c_i2c_read16(dev, ALS21C_REG_ALS_THRES_L));
+  printf("reg_als_thres_h %X\n", als21c_i2c_read16(dev, ALS21C_REG_ALS_THRES_H));
+  printf("reg_data_status %X\n", als21c_i2c_read8(dev, ALS21C_REG_DATA_STATUS));
+  printf("reg_als_data %X\n", als21c_i2c_read16(dev, ALS21C_REG_ALS_DATA));
+  printf("reg_prod_id %X\n", als21c_i2c_read16(dev, ALS21C_REG_PROD_ID));
+}
+
+#endif
+
+} /* namespace als21c */
+
+#endif
@@ -0,0 +1,209 @@
+/*!
+ *
+ * 	I2C Driver for NEWOPT XYC_ALS21C ambient light sensor
+ *
+ * 	This is a library for the NEWOPT XYC_ALS21C breakout:
+ * 	http://oshwlab.com/koendv/xyc_als21c_k1
+ *
+ *      software model of the sensor, for host builds without hardware.
+ *      compile with -DALS21C_SIM to use the model as I2C backend.
+ */
+
+#ifndef _XYC_ALS21C_K1_SIM_H
+#define _XYC_ALS21C_K1_SIM_H
+
+#include <cstddef>
+#include <cstdint>
+#include <xyc_als21c_k1.h>
+#include <xyc_als21c_k1_table.h>
+
+namespace als21c {
+
+/* integration time unit, microseconds */
+#define ALS21C_SIM_T_US 1171
+
+/* normalized count at 110000 lux; above this the analog part saturates */
+#define ALS21C_SIM_MAX_X ALS21C_CAL_MAX_X
+
+/* number of multiplexer channels */
+#define ALS21C_SIM_MUX_CHANNELS 8
+
+/*! light intensity at time t_us. Between two points lux is interpolated linearly. */
+typedef struct {
+  uint64_t t_us;
+  float lux;
+} als21c_sim_point_t;
+
+/*! light intensity as function of time, for flicker and other fast signals */
+typedef float (*als21c_sim_light_fn)(void *ctx, uint64_t t_us);
+
+/*! external clock, for a simulation in real time: time now, and wait until t_us. microseconds */
+typedef uint64_t (*als21c_sim_now_fn)(void *ctx);
+typedef void (*als21c_sim_wait_fn)(void *ctx, uint64_t t_us);
+
+/*!
+   model of one XYC-ALS21C-K1.
+   register map, integration and wait timing, saturation and overflow,
+   threshold and persistence interrupt logic.
+   configuration is latched at the start of each integration.
+   reading DATA_STATUS clears data_ready.
+   int_src and en_frst are not modeled.
+*/
+class als21c_sim {
+public:
+  als21c_sim();
+
+  /* power-on reset */
+  void power_on(uint64_t now_us);
+
+  /* light input */
+  void set_lux(float lux);
+  void set_trace(const als21c_sim_point_t *trace, size_t len, bool repeat);
+  void set_light(als21c_sim_light_fn fn, void *ctx);
+  float lux_at(uint64_t t_us) const;
+
+  /* run the model up to time now_us */
+  void advance(uint64_t now_us);
+
+  /* register access, at time now_us */
+  void read(uint64_t now_us, uint8_t reg, uint8_t *data, uint8_t len);
+  void write(uint64_t now_us, uint8_t reg, const uint8_t *data, uint8_t len);
+
+  /* INT line, true if asserted (pulled low) */
+  bool interrupt() const;
+
+  /* time of next event: end of integration or end of wait */
+  uint64_t next_event() const;
+
+  /* statistics */
+  uint32_t conversions;
+
+  /* sensor clock error, ppm. positive is slower */
+  int32_t clock_ppm;
+
+  /* lux to normalized count, inverse of the driver calibration polynomial */
+  static double lux_to_x(double lux);
+
+  uint8_t regs[256];
+
+private:
+  enum { IDLE, INTEGRATING, WAITING, SYNC_WAIT } state;
+  uint64_t t_start;     /* start of current integration or wait */
+  uint64_t t_end;       /* end of current integration or wait */
+  uint32_t gain;        /* gain latched at start of integration */
+  uint32_t itime;       /* integration time in units, latched */
+  uint8_t pers_count;   /* consecutive measurements outside thresholds */
+  float lux_const;
+  const als21c_sim_point_t *trace;
+  size_t trace_len;
+  bool trace_repeat;
+  als21c_sim_light_fn light_fn;
+  void *light_ctx;
+
+  bool running() const;
+  uint64_t sensor_us(uint64_t us) const;
+  void start_integration(uint64_t t_us);
+  void end_integration();
+  double mean_lux(uint64_t t0, uint64_t t1) const;
+  double trace_integral(uint64_t t_us) const;
+  double trace_integral_once(uint64_t t_us) const;
+  void reg_write(uint8_t reg, uint8_t value, uint64_t now_us);
+};
+
+/*!
+   I2C bus with simulated sensors and an optional TCA9548-style multiplexer.
+   owns the simulated clock. Use as bus handle of als21c_bus_t.
+*/
+class als21c_sim_bus {
+public:
+  als21c_sim_bus(als21c_sim *sensor = NULL);
+
+  /* attach sensor directly, or behind multiplexer channel */
+  void attach(als21c_sim *sensor, int8_t mux_channel = ALS21C_MUX_NONE);
+
+  /* simulated clock, microseconds */
+  uint64_t now() const { return now_fn ? now_fn(clock_ctx) : *clock; }
+  void share_clock(als21c_sim_bus *other);
+  void set_clock(als21c_sim_now_fn now_fn, als21c_sim_wait_fn wait_fn, void *ctx);
+  void advance(uint64_t us);
+  void advance_to(uint64_t t_us);
+
+  /* bus transactions, as issued by the driver */
+  bool read(uint8_t addr, uint8_t reg, uint8_t *data, uint8_t len);
+  bool write(uint8_t addr, uint8_t reg, const uint8_t *data, uint8_t len);
+  bool write_mux(uint8_t addr, uint8_t ctrl);
+
+  uint8_t mux_addr;
+  uint8_t mux_ctrl;
+  uint32_t transactions;
+  uint32_t mux_writes;
+
+  /* bus clock. every transaction advances the clock by its duration. 0 is infinitely fast */
+  uint32_t bus_hz;
+  /* time per transaction on top of the bus clock, e.g. driver and system call, microseconds */
+  uint32_t latency_us;
+  /* time the bus was busy, microseconds */
+  uint64_t busy_us;
+
+private:
+  uint64_t now_us;
+  uint64_t *clock; /* &now_us, or the clock of another bus */
+  als21c_sim_now_fn now_fn;
+  als21c_sim_wait_fn wait_fn;
+  void *clock_ctx;
+  als21c_sim *direct;
+  als21c_sim *channel[ALS21C_SIM_MUX_CHANNELS];
+  als21c_sim *selected(uint8_t addr);
+  void transfer(uint32_t bits);
+};
+
+/* sensor and bus used by sensors without bus handle */
+extern als21c_sim als21c_sim_default;
+extern als21c_sim_bus als21c_sim_default_bus;
+
+/*!
+   I2C transport for the simulator. Bus handle is an als21c_sim_bus *;
+   NULL is als21c_sim_default_bus.
+*/
+class als21c_sim_transport {
+public:
+  /* select bus and multiplexer channel */
+  static als21c_sim_bus *select(als21c_dev_t *dev) {
+    als21c_bus_t *bus = dev->bus;
+    als21c_sim_bus *sim = &als21c_sim_default_bus;
+    if (bus == NULL) return sim;
+    if (bus->handle != NULL) sim = (als21c_sim_bus *)bus->handle;
+    if (dev->mux_channel != ALS21C_MUX_NONE && bus->mux_channel != dev->mux_channel) {
+      dev->transactions++;
+      if (sim->write_mux(bus->mux_addr, uint8_t(1 << dev->mux_channel))) {
+        bus->mux_channel = dev->mux_channel;
+      } else {
+        bus->mux_channel = ALS21C_MUX_NONE;
+        dev->errors++;
+      }
+    }
+    return sim;
+  }
+
+  static bool read(als21c_dev_t *dev, const uint8_t reg, uint8_t *data, const uint8_t len) {
+    return select(dev)->read(dev->addr, reg, data, len);
+  }
+
+  static bool write(als21c_dev_t *dev, const uint8_t reg, const uint8_t *data, const uint8_t len) {
+    return select(dev)->write(dev->addr, reg, data, len);
+  }
+
+  /* simulated clock, microseconds. wraps around. */
+  static uint32_t micros(als21c_dev_t *dev) {
+    als21c_sim_bus *sim = &als21c_sim_default_bus;
+    if (dev->bus != NULL && dev->bus->handle != NULL) sim = (als21c_sim_bus *)dev->bus->handle;
+    return uint32_t(sim->now());
+  }
+
+  /* resolution of micros() */
+  static const uint32_t clock_res_us = 1;
+};
+
+} /* namespace als21c */
+
+#endif
@@ -0,0 +1,232 @@
+/*!
+ *
+ * 	I2C Driver for NEWOPT XYC_ALS21C ambient light sensor
+ *
+ * 	This is a library for the NEWOPT XYC_ALS21C breakout:
+ * 	http://oshwlab.com/koendv/xyc_als21c_k1
+ *
+ *      calibration tables, generated at compile time from the
+ *      calibration polynomial. C++11.
+ */
+
+#ifndef _XYC_ALS21C_K1_TABLE_H
+#define _XYC_ALS21C_K1_TABLE_H
+
+#include <cstdint>
+#ifdef __AVR__
+#include <avr/pgmspace.h>
+#endif
+
+namespace als21c {
+
+/* tables stay in flash. On AVR, const data is copied to SRAM unless PROGMEM */
+#ifdef __AVR__
+#define ALS21C_PROGMEM PROGMEM
+#else
+#define ALS21C_PROGMEM
+#endif
+
+/* read table entry from flash */
+inline uint16_t als21c_table_read(const uint16_t *p) {
+#ifdef __AVR__
+  return pgm_read_word(p);
+#else
+  return *p;
+#endif
+}
+
+inline uint32_t als21c_table_read(const uint32_t *p) {
+#ifdef __AVR__
+  return pgm_read_dword(p);
+#else
+  return *p;
+#endif
+}
+
+/*
+ * calibration polynomial.
+ * lux = c1 * x^1 + c3 * x^3 + c5 * x^5
+ * where x = count / (gain * itime), the normalized count.
+ *
+ * The relationship between lux and ALS_DATA register value has been
+ * obtained by curve-fitting VEML7700 and XYC-ALS21C-K1 measurements.
+ */
+#ifndef ALS21C_CAL_C1
+#define ALS21C_CAL_C1 478.233
+#define ALS21C_CAL_C3 0.0416391
+#define ALS21C_CAL_C5 -1.18758e-06
+#endif
+
+/* datasheet: als21c measures up to 110000 lux, about x = 130.498 */
+#define ALS21C_CAL_MAX_X 130.498
+
+/* lux at normalized count x */
+constexpr double als21c_cal_lux(double x) {
+  return ((ALS21C_CAL_C5 * x * x + ALS21C_CAL_C3) * x * x + ALS21C_CAL_C1) * x;
+}
+
+/* derivative of als21c_cal_lux() */
+constexpr double als21c_cal_slope(double x) {
+  return (5 * ALS21C_CAL_C5 * x * x + 3 * ALS21C_CAL_C3) * x * x + ALS21C_CAL_C1;
+}
+
+/* normalized count at lux, bisection on [lo, hi]. the polynomial is
+ * monotonic up to x = 155, beyond ALS21C_CAL_MAX_X */
+constexpr double als21c_cal_x(double lux, double lo = 0, double hi = 150, int n = 48) {
+  return n == 0 ? (lo + hi) / 2
+         : als21c_cal_lux((lo + hi) / 2) < lux ? als21c_cal_x(lux, (lo + hi) / 2, hi, n - 1)
+                                                : als21c_cal_x(lux, lo, (lo + hi) / 2, n - 1);
+}
+
+/* index sequence, C++11; log depth */
+template <unsigned... I>
+struct als21c_seq {};
+
+template <class A, class B>
+struct als21c_seq_cat;
+
+template <unsigned... A, unsigned... B>
+struct als21c_seq_cat<als21c_seq<A...>, als21c_seq<B...>> {
+  typedef als21c_seq<A..., (sizeof...(A) + B)...> type;
+};
+
+template <unsigned N>
+struct als21c_make_seq {
+  typedef typename als21c_seq_cat<typename als21c_make_seq<N / 2>::type, typename als21c_make_seq<N - N / 2>::type>::type type;
+};
+
+template <>
+struct als21c_make_seq<0> {
+  typedef als21c_seq<> type;
+};
+
+template <>
+struct als21c_make_seq<1> {
+  typedef als21c_seq<0> type;
+};
+
+/* smallest shift so that value >> shift fits in T */
+template <typename T>
+constexpr unsigned als21c_fit_shift(double value, unsigned shift = 0) {
+  return value / (1ul << shift) <= double(T(~T(0))) ? shift : als21c_fit_shift<T>(value, shift + 1);
+}
+
+/*!
+   lux table: lux at x = i * 2^STEP_SHIFT / 256, for x from 0 to MAX_X.
+   above MAX_X, lookup() returns the last entry.
+   T: entry width, uint16_t or uint32_t.
+   STEP_SHIFT: step in normalized count, as power of two in 1/256. 8 is a step of 1.
+   MAX_X: range in normalized count.
+   entries are stored as lux >> SCALE_SHIFT; SCALE_SHIFT is the smallest
+   shift that fits the range in T.
+   data() is the table contents. Define the table at namespace scope:
+     static const table_t::data_t lux_table ALS21C_PROGMEM = table_t::data();
+   gcc ignores PROGMEM on static members of class templates.
+   lookup() interpolates linearly, in constant time, without division.
+*/
+template <typename T, unsigned STEP_SHIFT, unsigned MAX_X, class Seq = typename als21c_make_seq<(((MAX_X << 8) + (1u << STEP_SHIFT) - 1) >> STEP_SHIFT) + 1>::type>
+struct als21c_lux_table;
+
+template <typename T, unsigned STEP_SHIFT, unsigned MAX_X, unsigned... I>
+struct als21c_lux_table<T, STEP_SHIFT, MAX_X, als21c_seq<I...>> {
+  static constexpr unsigned step_shift = STEP_SHIFT;
+  static constexpr unsigned length = sizeof...(I);
+  static constexpr unsigned scale_shift = als21c_fit_shift<T>(als21c_cal_lux(MAX_X));
+
+  typedef struct {
+    T value[length];
+  } data_t;
+
+  static constexpr data_t data() {
+    return data_t{ { T(als21c_cal_lux(double(I << STEP_SHIFT) / 256) / (1ul << scale_shift) + 0.5)... } };
+  }
+
+  /* the same table, 32-bit, shifted back. for vector gathers */
+  typedef struct {
+    int32_t value[length];
+  } wide_t;
+
+  static constexpr wide_t wide() {
+    return wide_t{ { int32_t(T(als21c_cal_lux(double(I << STEP_SHIFT) / 256) / (1ul << scale_shift) + 0.5)) << scale_shift... } };
+  }
+
+  /* lux at q = 256 * x */
+  static int32_t lookup(const data_t &table, uint32_t q) {
+    uint32_t x1 = q >> STEP_SHIFT;
+    uint32_t delta_x = q & ((1ul << STEP_SHIFT) - 1);
+    /* saturate at the last entry */
+    if (x1 > length - 2) {
+      x1 = length - 2;
+      delta_x = 1ul << STEP_SHIFT;
+    }
+    int32_t y1 = int32_t(als21c_table_read(&table.value[x1])) << scale_shift;
+    int32_t y2 = int32_t(als21c_table_read(&table.value[x1 + 1])) << scale_shift;
+    return y1 + (((y2 - y1) * int32_t(delta_x)) >> STEP_SHIFT);
+  }
+};
+
+/*!
+   inverse table: 256 * x at lux = i * 2^STEP_SHIFT, up to MAX_LUX.
+   lookup() returns 256 * x << STEP_SHIFT, interpolated.
+*/
+template <unsigned STEP_SHIFT, unsigned MAX_LUX, class Seq = typename als21c_make_seq<(MAX_LUX >> STEP_SHIFT) + 1>::type>
+struct als21c_count_table;
+
+template <unsigned STEP_SHIFT, unsigned MAX_LUX, unsigned... I>
+struct als21c_count_table<STEP_SHIFT, MAX_LUX, als21c_seq<I...>> {
+  static constexpr unsigned step_shift = STEP_SHIFT;
+  static constexpr unsigned length = sizeof...(I);
+
+  typedef struct {
+    uint16_t value[length];
+  } data_t;
+
+  static constexpr data_t data() {
+    return data_t{ { uint16_t(256 * als21c_cal_x(double(uint32_t(I) << STEP_SHIFT)) + 0.5)... } };
+  }
+
+  /* 256 * x << STEP_SHIFT at lux */
+  static uint32_t lookup(const data_t &table, uint32_t lux) {
+    uint32_t x1 = lux >> STEP_SHIFT;
+    uint32_t delta_lux = lux & ((1ul << STEP_SHIFT) - 1);
+    if (x1 > length - 2) {
+      x1 = length - 2;
+      delta_lux = 1ul << STEP_SHIFT;
+    }
+    uint16_t y1 = als21c_table_read(&table.value[x1]);
+    uint16_t y2 = als21c_table_read(&table.value[x1 + 1]);
+    return (uint32_t(y1) << STEP_SHIFT) + uint32_t(y2 - y1) * delta_lux;
+  }
+};
+
+/*
+ * tables of this build. Trade flash size against interpolation error:
+ * ALS21C_LUX_TABLE_TYPE: uint32_t or uint16_t. uint16_t on AVR, half the flash
+ * ALS21C_LUX_TABLE_STEP_SHIFT: 7 (step 0.5), 8 (step 1), 9 (step 2), ...
+ * ALS21C_LUX_TABLE_MAX_X: range, normalized count
+ * ALS21C_COUNT_TABLE_SHIFT: inverse table step, 10 is 1024 lux
+ * extras/lux_table_error.cpp reports size and error of each choice.
+ */
+#ifndef ALS21C_LUX_TABLE_TYPE
+#ifdef __AVR__
+#define ALS21C_LUX_TABLE_TYPE uint16_t
+#else
+#define ALS21C_LUX_TABLE_TYPE uint32_t
+#endif
+#endif
+#ifndef ALS21C_LUX_TABLE_STEP_SHIFT
+#define ALS21C_LUX_TABLE_STEP_SHIFT 8
+#endif
+#ifndef ALS21C_LUX_TABLE_MAX_X
+#define ALS21C_LUX_TABLE_MAX_X 131
+#endif
+#ifndef ALS21C_COUNT_TABLE_SHIFT
+#define ALS21C_COUNT_TABLE_SHIFT 10
+#endif
+
+typedef als21c_lux_table<ALS21C_LUX_TABLE_TYPE, ALS21C_LUX_TABLE_STEP_SHIFT, ALS21C_LUX_TABLE_MAX_X> als21c_lux_table_t;
+typedef als21c_count_table<ALS21C_COUNT_TABLE_SHIFT, 110592> als21c_count_table_t;
+
+} /* namespace als21c */
+
+#endif
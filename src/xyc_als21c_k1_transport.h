@@ -0,0 +1,42 @@
+/*!
+ *
+ * 	I2C Driver for NEWOPT XYC_ALS21C ambient light sensor
+ *
+ * 	This is a library for the NEWOPT XYC_ALS21C breakout:
+ * 	http://oshwlab.com/koendv/xyc_als21c_k1
+ *
+ *      I2C transport of this build, used by the als21c_* functions.
+ *      ALS21C_SIM: simulator
+ *      ARDUINO: Wire
+ *      __RTTHREAD__: rt-thread i2c bus device
+ *      __linux__: linux i2c-dev
+ */
+
+#ifndef _XYC_ALS21C_K1_TRANSPORT_H
+#define _XYC_ALS21C_K1_TRANSPORT_H
+
+#if defined(ALS21C_SIM)
+#include <xyc_als21c_k1_sim.h>
+namespace als21c {
+typedef als21c_sim_transport als21c_transport;
+}
+#elif defined(ARDUINO)
+#include <xyc_als21c_k1_wire.h>
+namespace als21c {
+typedef als21c_wire_transport als21c_transport;
+}
+#elif defined(__RTTHREAD__)
+#include <xyc_als21c_k1_rtthread.h>
+namespace als21c {
+typedef als21c_rtthread_transport als21c_transport;
+}
+#elif defined(__linux__)
+#include <xyc_als21c_k1_linux.h>
+namespace als21c {
+typedef als21c_linux_transport als21c_transport;
+}
+#else
+#error "xyc_als21c_k1: no I2C transport for this platform"
+#endif
+
+#endif
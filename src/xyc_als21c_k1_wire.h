@@ -0,0 +1,76 @@
+/*!
+ *
+ * 	I2C Driver for NEWOPT XYC_ALS21C ambient light sensor
+ *
+ * 	This is a library for the NEWOPT XYC_ALS21C breakout:
+ * 	http://oshwlab.com/koendv/xyc_als21c_k1
+ *
+ *      I2C transport for Arduino Wire
+ */
+
+#ifndef _XYC_ALS21C_K1_WIRE_H
+#define _XYC_ALS21C_K1_WIRE_H
+
+#include <xyc_als21c_k1.h>
+#include <Wire.h>
+
+namespace als21c {
+
+/*!
+   I2C transport for Arduino. Bus handle is a TwoWire *; NULL is Wire.
+*/
+class als21c_wire_transport {
+public:
+  /* select bus and multiplexer channel */
+  static TwoWire *select(als21c_dev_t *dev) {
+    als21c_bus_t *bus = dev->bus;
+    TwoWire *wire = &Wire;
+    if (bus == NULL) return wire;
+    if (bus->handle != NULL) wire = (TwoWire *)bus->handle;
+    if (dev->mux_channel != ALS21C_MUX_NONE && bus->mux_channel != dev->mux_channel) {
+      wire->beginTransmission(bus->mux_addr);
+      wire->write(uint8_t(1 << dev->mux_channel));
+      dev->transactions++;
+      if (wire->endTransmission() == 0) {
+        bus->mux_channel = dev->mux_channel;
+      } else {
+        bus->mux_channel = ALS21C_MUX_NONE;
+        dev->errors++;
+      }
+    }
+    return wire;
+  }
+
+  static bool read(als21c_dev_t *dev, const uint8_t reg, uint8_t *data, const uint8_t len) {
+    TwoWire *wire = select(dev);
+    wire->beginTransmission(dev->addr);
+    wire->write(reg);
+    wire->endTransmission(false);
+    if (wire->requestFrom(dev->addr, len) != len) {
+      return false;
+    }
+    for (uint8_t i = 0; i < len; i++)
+      data[i] = wire->read();
+    return true;
+  }
+
+  static bool write(als21c_dev_t *dev, const uint8_t reg, const uint8_t *data, const uint8_t len) {
+    TwoWire *wire = select(dev);
+    wire->beginTransmission(dev->addr);
+    wire->write(reg);
+    wire->write(data, len);
+    return wire->endTransmission() == 0;
+  }
+
+  /* clock, microseconds. wraps around. */
+  static uint32_t micros(als21c_dev_t *) {
+    return ::micros();
+  }
+
+  /* resolution of micros() */
+  static const uint32_t clock_res_us = 8;
+};
+
+} /* namespace als21c */
+
+#endif
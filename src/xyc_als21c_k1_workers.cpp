@@ -0,0 +1,262 @@
+/*!
+ *
+ * 	I2C Driver for NEWOPT XYC_ALS21C ambient light sensor
+ *
+ * 	This is a library for the NEWOPT XYC_ALS21C breakout:
+ * 	http://oshwlab.com/koendv/xyc_als21c_k1
+ *
+ *      linux: one worker thread per I2C bus. while one bus waits for an
+ *      ioctl, the others keep going.
+ */
+
+#if defined(__linux__) && !defined(ARDUINO)
+
+#include <xyc_als21c_k1_workers.h>
+#include <cerrno>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+namespace als21c {
+
+/*
+ * reading queues.
+ * one single-producer, single-consumer queue per worker, with free-running
+ * 32-bit indices. The worker writes the entry, then publishes head with
+ * release semantics; the consumer reads head with acquire semantics.
+ * no locks. A consumer with nothing to read arms, sets waiting, and
+ * sleeps on an eventfd. A worker that queued a reading writes the eventfd only if
+ * waiting is set, so there is no system call while the consumer keeps up.
+ * a full fence between the store of head or waiting and the load of the
+ * other makes sure at least one of the two sees the other: no lost wakeup.
+ */
+
+#define ALS21C_LOAD_ACQUIRE(p) __atomic_load_n(p, __ATOMIC_ACQUIRE)
+#define ALS21C_STORE_RELEASE(p, v) __atomic_store_n(p, v, __ATOMIC_RELEASE)
+#define ALS21C_FENCE() __atomic_thread_fence(__ATOMIC_SEQ_CST)
+
+/*!
+ * @brief  initialize workers, without sensors. does not access the bus.
+ */
+void als21c_workers_init(als21c_workers_t *workers) {
+  workers->n = 0;
+  workers->next = 0;
+  workers->event_fd = -1;
+  workers->waiting = 0;
+}
+
+/*!
+ * @brief  add a sensor. the sensor goes to the worker of its bus.
+ * @param  dev
+ *         initialized with als21c_init() and als21c_begin(), with a bus of its own adapter.
+ *         a sensor without tracker gets one of the worker, see als21c_set_track().
+ * @return false if started, if there are ALS21C_WORKERS_MAX buses already,
+ *         or if the bus has ALS21C_FLEET_MAX sensors
+ */
+bool als21c_workers_add(als21c_workers_t *workers, als21c_dev_t *dev) {
+  als21c_worker_t *w = NULL;
+  if (workers->event_fd >= 0) return false;
+  for (uint8_t i = 0; i < workers->n; i++)
+    if (workers->worker[i].bus == dev->bus) w = &workers->worker[i];
+  if (w == NULL) {
+    if (workers->n >= ALS21C_WORKERS_MAX) return false;
+    w = &workers->worker[workers->n++];
+    w->bus = dev->bus;
+    w->running = false;
+    w->stop_fd = -1;
+    als21c_fleet_init(&w->fleet);
+  }
+  if (w->fleet.n >= ALS21C_FLEET_MAX) return false;
+  /* gain, integration time and flags of every reading, and the sensor clock followed */
+  if (dev->track == NULL) als21c_set_track(dev, &w->track[w->fleet.n]);
+  return als21c_fleet_add(&w->fleet, dev);
+}
+
+/* queue a reading for the consumer, and wake the consumer if waiting */
+static void als21c_worker_push(als21c_worker_t *w, const als21c_worker_reading_t *reading) {
+  uint32_t head = w->head;
+  uint32_t tail = ALS21C_LOAD_ACQUIRE(&w->tail);
+  uint64_t one = 1;
+  if (head - tail >= ALS21C_WORKER_READINGS) {
+    w->overruns++;
+    return;
+  }
+  w->reading[head & (ALS21C_WORKER_READINGS - 1)] = *reading;
+  ALS21C_STORE_RELEASE(&w->head, head + 1);
+  ALS21C_FENCE();
+  if (__atomic_load_n(w->waiting, __ATOMIC_RELAXED) && write(w->event_fd, &one, sizeof(one)) < 0) {
+    /* counter full: the consumer is woken anyway */
+  }
+}
+
+/* worker thread: read the sensors on the bus in deadline order, sleep until the next deadline */
+static void *als21c_worker_main(void *arg) {
+  als21c_worker_t *w = (als21c_worker_t *)arg;
+  als21c_dev_t *clock = w->fleet.dev[0];
+  struct pollfd pfd = { w->stop_fd, POLLIN, 0 };
+
+  als21c_fleet_start(&w->fleet, w->once);
+  while (!ALS21C_LOAD_ACQUIRE(&w->stop)) {
+    als21c_worker_reading_t r;
+    struct timespec ts;
+    int32_t wait_us;
+
+    /* a bus that cannot keep up never runs out of samples: check stop after every reading */
+    while (!ALS21C_LOAD_ACQUIRE(&w->stop) &&
+           (r.reading.lux = als21c_fleet_poll(&w->fleet, als21c_micros(clock), &r.dev)) != ALS21C_ERR_NOT_READY) {
+      r.reading.t_us = als21c_micros(clock);
+      r.reading.count = r.dev->data.als_data;
+      r.reading.config_gen = r.dev->config_gen;
+      r.gain = r.dev->track->gain;
+      r.itime = r.dev->track->itime;
+      r.flags = r.dev->track->flags;
+      als21c_worker_push(w, &r);
+    }
+
+    /* sleep until the next deadline, or until stopped */
+    wait_us = als21c_fleet_deadline(&w->fleet) - als21c_micros(clock);
+    if (wait_us < 0) wait_us = 0;
+    ts.tv_sec = wait_us / 1000000;
+    ts.tv_nsec = (wait_us % 1000000) * 1000;
+    ppoll(&pfd, 1, &ts, NULL);
+  }
+  als21c_fleet_stop(&w->fleet);
+  return NULL;
+}
+
+/*!
+ * @brief  start one worker thread per bus. from now on, only the workers touch the sensors.
+ * @param  once
+ *         true: single measurements. false: continuous measurement. see als21c_fleet_start().
+ * @return false if a thread or eventfd could not be created; errno is set.
+ */
+bool als21c_workers_start(als21c_workers_t *workers, bool once) {
+  workers->event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (workers->event_fd < 0) return false;
+  workers->next = 0;
+  for (uint8_t i = 0; i < workers->n; i++) {
+    als21c_worker_t *w = &workers->worker[i];
+    int err;
+    w->once = once;
+    w->stop = false;
+    w->head = w->tail = 0;
+    w->overruns = 0;
+    w->event_fd = workers->event_fd;
+    w->waiting = &workers->waiting;
+    w->stop_fd = eventfd(0, EFD_CLOEXEC);
+    if (w->stop_fd < 0) {
+      als21c_workers_stop(workers);
+      return false;
+    }
+    err = pthread_create(&w->thread, NULL, als21c_worker_main, w);
+    if (err != 0) {
+      als21c_workers_stop(workers);
+      errno = err;
+      return false;
+    }
+    w->running = true;
+  }
+  return true;
+}
+
+/*!
+ * @brief  stop the workers and wait for them. the workers stop their sensors.
+ *         readings still queued can be read after.
+ */
+void als21c_workers_stop(als21c_workers_t *workers) {
+  for (uint8_t i = 0; i < workers->n; i++) {
+    als21c_worker_t *w = &workers->worker[i];
+    if (w->running) {
+      uint64_t one = 1;
+      ALS21C_STORE_RELEASE(&w->stop, true);
+      if (write(w->stop_fd, &one, sizeof(one)) < 0) {
+        /* cannot fail: counter is far from full */
+      }
+      pthread_join(w->thread, NULL);
+      w->running = false;
+    }
+    if (w->stop_fd >= 0) close(w->stop_fd);
+    w->stop_fd = -1;
+  }
+  if (workers->event_fd >= 0) close(workers->event_fd);
+  workers->event_fd = -1;
+}
+
+/*!
+ * @brief  take the oldest reading of a worker. workers in turn.
+ *         call from one consumer thread only.
+ * @return false if no readings queued
+ */
+bool als21c_workers_read(als21c_workers_t *workers, als21c_worker_reading_t *reading) {
+  for (uint8_t k = 0; k < workers->n; k++) {
+    uint8_t i = (workers->next + k) % workers->n;
+    als21c_worker_t *w = &workers->worker[i];
+    uint32_t head = ALS21C_LOAD_ACQUIRE(&w->head);
+    uint32_t tail = w->tail;
+    if (head == tail) continue;
+    *reading = w->reading[tail & (ALS21C_WORKER_READINGS - 1)];
+    ALS21C_STORE_RELEASE(&w->tail, tail + 1);
+    workers->next = (i + 1) % workers->n;
+    return true;
+  }
+  return false;
+}
+
+/*!
+ * @brief  consumer about to sleep: have the workers write the eventfd for the
+ *         next reading. call when als21c_workers_read() returns false.
+ * @return false if readings were queued meanwhile: not armed, read them first
+ */
+bool als21c_workers_arm(als21c_workers_t *workers) {
+  __atomic_store_n(&workers->waiting, 1, __ATOMIC_RELAXED);
+  ALS21C_FENCE();
+  for (uint8_t i = 0; i < workers->n; i++) {
+    if (ALS21C_LOAD_ACQUIRE(&workers->worker[i].head) != workers->worker[i].tail) {
+      __atomic_store_n(&workers->waiting, 0, __ATOMIC_RELAXED);
+      return false;
+    }
+  }
+  return true;
+}
+
+/*!
+ * @brief  consumer awake: workers stop writing the eventfd, and the eventfd is reset.
+ */
+void als21c_workers_disarm(als21c_workers_t *workers) {
+  uint64_t count;
+  __atomic_store_n(&workers->waiting, 0, __ATOMIC_RELAXED);
+  /* nonblocking */
+  if (read(workers->event_fd, &count, sizeof(count)) < 0) {
+    /* not written */
+  }
+}
+
+/*!
+ * @brief  wait for readings. call when als21c_workers_read() returns false.
+ * @param  timeout_ms
+ *         -1 waits without timeout
+ * @return true if there may be readings, false on timeout
+ */
+bool als21c_workers_wait(als21c_workers_t *workers, int timeout_ms) {
+  struct pollfd pfd = { workers->event_fd, POLLIN, 0 };
+  bool ready;
+  if (!als21c_workers_arm(workers)) return true;
+  ready = poll(&pfd, 1, timeout_ms) > 0;
+  als21c_workers_disarm(workers);
+  return ready;
+}
+
+/*!
+ * @brief  eventfd of the consumer, for an event loop.
+ *         only written while armed. the loop reads until als21c_workers_read()
+ *         returns false, then als21c_workers_arm(); if that returns false,
+ *         reads again. once armed, it waits for the eventfd, and when readable
+ *         calls als21c_workers_disarm() and reads.
+ */
+int als21c_workers_fd(als21c_workers_t *workers) {
+  return workers->event_fd;
+}
+
+} /* namespace als21c */
+
+#endif
@@ -0,0 +1,93 @@
+/*!
+ *
+ * 	I2C Driver for NEWOPT XYC_ALS21C ambient light sensor
+ *
+ * 	This is a library for the NEWOPT XYC_ALS21C breakout:
+ * 	http://oshwlab.com/koendv/xyc_als21c_k1
+ *
+ *      linux: one worker thread per I2C bus. a worker owns the sensors on
+ *      its bus, reads them as a fleet, in deadline order, and queues the
+ *      readings for one consumer thread.
+ */
+
+#ifndef _XYC_ALS21C_K1_WORKERS_H
+#define _XYC_ALS21C_K1_WORKERS_H
+
+#include <xyc_als21c_k1.h>
+#include <pthread.h>
+
+namespace als21c {
+
+/* most buses, one worker each */
+#ifndef ALS21C_WORKERS_MAX
+#define ALS21C_WORKERS_MAX 8
+#endif
+
+/* readings queued per worker, power of two */
+#ifndef ALS21C_WORKER_READINGS
+#define ALS21C_WORKER_READINGS 256
+#endif
+
+/*! one reading, and the sensor it is from. the consumer does not touch dev; the worker copies what it needs */
+typedef struct {
+  als21c_dev_t *dev;
+  als21c_reading_t reading; /* t_us: time of read */
+  uint16_t gain;            /* dev->track->gain */
+  uint16_t itime;           /* dev->track->itime */
+  uint8_t flags;            /* dev->track->flags */
+} als21c_worker_reading_t;
+
+/*!
+   worker of one bus.
+   fleet: the sensors on the bus. only the worker thread touches them, and the bus, once started.
+   reading: queue to the consumer. one producer, the worker, and one consumer.
+   head is only written by the worker, tail only by the consumer; on separate cache lines.
+   overruns: readings lost, consumer too slow.
+   track: sample tracking of the sensors added without.
+   stop: set to stop the worker. stop_fd: eventfd, wakes the worker to stop.
+   event_fd, waiting: of the consumer, see als21c_workers_t.
+*/
+typedef struct {
+  als21c_fleet_t fleet;
+  als21c_bus_t *bus;
+  pthread_t thread;
+  bool stop;
+  int stop_fd;
+  int event_fd;
+  uint32_t *waiting;
+  bool once;
+  bool running;
+  uint32_t overruns;
+  als21c_track_t track[ALS21C_FLEET_MAX];
+  alignas(64) uint32_t head;
+  alignas(64) uint32_t tail;
+  alignas(64) als21c_worker_reading_t reading[ALS21C_WORKER_READINGS];
+} als21c_worker_t;
+
+/*!
+   workers of all buses, and their consumer.
+   event_fd: eventfd, written by a worker that queues a reading while the consumer waits.
+   waiting: consumer armed, als21c_workers_arm(), until als21c_workers_disarm().
+   next: worker the consumer reads first, round robin.
+*/
+typedef struct {
+  als21c_worker_t worker[ALS21C_WORKERS_MAX];
+  uint8_t n;
+  uint8_t next;
+  int event_fd;
+  alignas(64) uint32_t waiting;
+} als21c_workers_t;
+
+void als21c_workers_init(als21c_workers_t *workers);
+bool als21c_workers_add(als21c_workers_t *workers, als21c_dev_t *dev);
+bool als21c_workers_start(als21c_workers_t *workers, bool once);
+void als21c_workers_stop(als21c_workers_t *workers);
+bool als21c_workers_read(als21c_workers_t *workers, als21c_worker_reading_t *reading);
+bool als21c_workers_arm(als21c_workers_t *workers);
+void als21c_workers_disarm(als21c_workers_t *workers);
+bool als21c_workers_wait(als21c_workers_t *workers, int timeout_ms);
+int als21c_workers_fd(als21c_workers_t *workers);
+
+} /* namespace als21c */
+
+#endif